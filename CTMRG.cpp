@@ -0,0 +1,404 @@
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <vector>
+#include <complex>
+
+using std::cout;
+using std::endl;
+using std::vector;
+using std::complex;
+using std::ofstream;
+
+#include "include.h"
+
+using namespace global;
+
+/**
+ * empty constructor: default parameters
+ */
+CTMRG::CTMRG(){
+
+   max_iter = 10;
+   tol = 1.0e-10;
+   conv = 0.0;
+
+}
+
+/**
+ * constructor with input parameters
+ * @param max_iter_in maximal number of down/up iterations in calc
+ * @param tol_in convergence criterion on the relative change of the norm
+ */
+CTMRG::CTMRG(int max_iter_in,double tol_in){
+
+   max_iter = max_iter_in;
+   tol = tol_in;
+   conv = 0.0;
+
+}
+
+/**
+ * copy constructor: only the parameters are copied, the corners and projectors are temporary objects
+ */
+CTMRG::CTMRG(const CTMRG &ctm_copy){
+
+   max_iter = ctm_copy.gmax_iter();
+   tol = ctm_copy.gtol();
+   conv = ctm_copy.gconv();
+
+}
+
+/**
+ * empty destructor
+ */
+CTMRG::~CTMRG(){ }
+
+/**
+ * @return the maximal number of iterations
+ */
+int CTMRG::gmax_iter() const {
+
+   return max_iter;
+
+}
+
+/**
+ * @return the convergence criterion
+ */
+double CTMRG::gtol() const {
+
+   return tol;
+
+}
+
+/**
+ * @return the relative change of the norm in the last iteration of calc
+ */
+double CTMRG::gconv() const {
+
+   return conv;
+
+}
+
+/**
+ * construct all the bottom and top layers of the environment by iterating down and up moves until the norm of the state is converged
+ * @param peps input PEPS<double>
+ * @param env Environment in which the layers are stored, its top layers are used as starting point if warm is true
+ * @param warm if true, start from the present top layers of env (when they fit the peps), otherwise from unit boundaries
+ * @return the number of iterations performed
+ */
+int CTMRG::calc(const PEPS<double> &peps,Environment &env,bool warm){
+
+   //the outer layers are exact
+   env.fill('b',peps);
+   env.fill('t',peps);
+
+   for(int i = 0;i < Ly - 3;++i)
+      if(!warm || !compatible(i,peps,env)){
+
+         //unit boundary: contracts the up legs of ket and bra of row i + 1 with each other
+         for(int col = 0;col < Lx;++col){
+
+            int Dv = peps(i + 1,col).shape(1);
+
+            env.gt(i)[col].resize(1,Dv,Dv,1);
+            env.gt(i)[col] = 0.0;
+
+            for(int k = 0;k < Dv;++k)
+               env.gt(i)[col](0,k,k,0) = 1.0;
+
+         }
+
+      }
+
+   //the norm is evaluated in the middle of the lattice
+   int mid = (Ly - 2)/2;
+
+   double prev = 0.0;
+
+   int iter = 0;
+
+   while(iter < max_iter){
+
+      for(int row = 1;row < Ly - 2;++row)
+         this->move('b',row,peps,env);
+
+      for(int row = Ly - 4;row >= 0;--row)
+         this->move('t',row,peps,env);
+
+      double val = env.gb(mid).dot(env.gt(mid - 1));
+
+      ++iter;
+
+      conv = std::fabs(val - prev)/std::fabs(val);
+
+#ifdef _DEBUG
+      cout << "CTMRG iteration " << iter << "\t" << val << "\t" << conv << endl;
+#endif
+
+      if(conv < tol)
+         break;
+
+      prev = val;
+
+   }
+
+   return iter;
+
+}
+
+/**
+ * directional move: absorb a peps row into a boundary layer and truncate the new bonds with the projectors from the corners.
+ * The layer on the opposite side of the strip must be present in env.
+ * @param option 'b'ottom: construct b[row] from b[row-1] and peps row 'row', closed by t[row]
+ *               't'op: construct t[row] from t[row+1] and peps row 'row+2', closed by b[row]
+ * @param row index of the layer to be constructed
+ * @param peps input PEPS<double>
+ * @param env Environment containing the boundary layers
+ */
+void CTMRG::move(const char option,int row,const PEPS<double> &peps,Environment &env){
+
+   this->corners(option,row,peps,env);
+
+   P_L.resize(Lx - 1);
+   P_R.resize(Lx - 1);
+
+   for(int col = 0;col < Lx - 1;++col)
+      this->projectors(option,col,env.gD_aux());
+
+   //trivial projectors on the edges
+   DArray<4> edge(1,1,1,1);
+   edge = 1.0;
+
+   if(option == 'b'){
+
+      MPO<double> &layer = env.gb(row);
+
+      for(int col = 0;col < Lx;++col){
+
+         const DArray<4> &left = (col == 0) ? edge : P_R[col - 1];
+         const DArray<4> &right = (col == Lx - 1) ? edge : P_L[col];
+
+         DArray<6> tmp6;
+         Contract(1.0,left,shape(3),env.gb(row - 1)[col],shape(0),0.0,tmp6);
+
+         DArray<7> tmp7;
+         Contract(1.0,tmp6,shape(1,3),peps(row,col),shape(0,3),0.0,tmp7);
+
+         tmp6.clear();
+         Contract(1.0,tmp7,shape(1,2,5),peps(row,col),shape(0,3,2),0.0,tmp6);
+
+         layer[col].clear();
+         Contract(1.0,tmp6,shape(3,5,1),right,shape(0,1,2),0.0,layer[col]);
+
+      }
+
+   }
+   else{
+
+      //peps index is row+2!
+      int prow = row + 2;
+
+      MPO<double> &layer = env.gt(row);
+
+      for(int col = 0;col < Lx;++col){
+
+         const DArray<4> &left = (col == 0) ? edge : P_R[col - 1];
+         const DArray<4> &right = (col == Lx - 1) ? edge : P_L[col];
+
+         DArray<6> tmp6;
+         Contract(1.0,left,shape(1),env.gt(row + 1)[col],shape(0),0.0,tmp6);
+
+         DArray<7> tmp7;
+         Contract(1.0,tmp6,shape(1,3),peps(prow,col),shape(0,1),0.0,tmp7);
+
+         tmp6.clear();
+         Contract(1.0,tmp7,shape(1,2,4),peps(prow,col),shape(0,1,2),0.0,tmp6);
+
+         layer[col].clear();
+         Contract(1.0,tmp6,shape(1,3,5),right,shape(0,1,2),0.0,layer[col]);
+
+      }
+
+   }
+
+}
+
+/**
+ * construct the left and right corners of the two-row strip: boundary layer T on top, upper peps row, lower peps row and boundary layer B below
+ * @param option 'b'ottom: T = t[row], upper row = row + 1, lower row = row, B = b[row - 1]
+ *               't'op: T = t[row + 1], upper row = row + 2, lower row = row + 1, B = b[row]
+ * @param row index of the layer to be constructed
+ * @param peps input PEPS<double>
+ * @param env Environment containing the boundary layers
+ */
+void CTMRG::corners(const char option,int row,const PEPS<double> &peps,const Environment &env){
+
+   const MPO<double> &T = (option == 'b') ? env.gt(row) : env.gt(row + 1);
+   const MPO<double> &B = (option == 'b') ? env.gb(row - 1) : env.gb(row);
+
+   int lrow = (option == 'b') ? row : row + 1;
+   int urow = lrow + 1;
+
+   C_L.resize(Lx);
+   C_R.resize(Lx);
+
+   DArray<6> edge(1,1,1,1,1,1);
+   edge = 1.0;
+
+   //left corners: open legs are the right legs of column col
+   for(int col = 0;col < Lx - 1;++col){
+
+      const DArray<6> &prev = (col == 0) ? edge : C_L[col - 1];
+
+      DArray<8> tmp8;
+      Contract(1.0,prev,shape(0),T[col],shape(0),0.0,tmp8);
+
+      DArray<9> tmp9;
+      Contract(1.0,tmp8,shape(0,5),peps(urow,col),shape(0,1),0.0,tmp9);
+
+      tmp8.clear();
+      Contract(1.0,tmp9,shape(0,4,6),peps(urow,col),shape(0,1,2),0.0,tmp8);
+
+      tmp9.clear();
+      Contract(1.0,tmp8,shape(0,4),peps(lrow,col),shape(0,1),0.0,tmp9);
+
+      tmp8.clear();
+      Contract(1.0,tmp9,shape(0,4,6),peps(lrow,col),shape(0,1,2),0.0,tmp8);
+
+      C_L[col].clear();
+      Contract(1.0,tmp8,shape(0,4,6),B[col],shape(0,1,2),0.0,C_L[col]);
+
+   }
+
+   //right corners: open legs are the left legs of column col
+   for(int col = Lx - 1;col > 0;--col){
+
+      const DArray<6> &prev = (col == Lx - 1) ? edge : C_R[col + 1];
+
+      DArray<8> tmp8;
+      Contract(1.0,T[col],shape(3),prev,shape(0),0.0,tmp8);
+
+      DArray<9> tmp9;
+      Contract(1.0,tmp8,shape(1,3),peps(urow,col),shape(1,4),0.0,tmp9);
+
+      tmp8.clear();
+      Contract(1.0,tmp9,shape(1,2,7),peps(urow,col),shape(1,4,2),0.0,tmp8);
+
+      tmp9.clear();
+      Contract(1.0,tmp8,shape(1,5),peps(lrow,col),shape(4,1),0.0,tmp9);
+
+      tmp8.clear();
+      Contract(1.0,tmp9,shape(1,5,7),peps(lrow,col),shape(4,1,2),0.0,tmp8);
+
+      C_R[col].clear();
+      Contract(1.0,tmp8,shape(1,5,7),B[col],shape(3,1,2),0.0,C_R[col]);
+
+   }
+
+}
+
+/**
+ * construct the projectors on the bond between col and col + 1 from the corners: with M = C_L * C_R^T = U S V^T,
+ * P_L = C_R^T V S^{-1/2} and P_R = S^{-1/2} U^T C_L, so that C_L P_L P_R C_R^T = M on the kept subspace.
+ * Singular values are truncated to D_aux and those smaller than 1e-12 times the largest one are discarded.
+ * @param option 'b'ottom: the new bond is formed by the lower legs of the corners, 't'op: by the upper legs
+ * @param col column index on the left of the bond
+ * @param D_aux maximal dimension of the new bond
+ */
+void CTMRG::projectors(const char option,int col,int D_aux){
+
+   const DArray<6> &L = C_L[col];
+   const DArray<6> &R = C_R[col + 1];
+
+   DArray<6> M;
+
+   if(option == 'b')
+      Gemm(CblasNoTrans,CblasTrans,1.0,L,R,0.0,M);
+   else
+      Gemm(CblasTrans,CblasNoTrans,1.0,L,R,0.0,M);
+
+   DArray<1> S;
+   DArray<4> U;
+   DArray<4> VT;
+
+   Gesvd('S','S',M,S,U,VT,D_aux);
+
+   //discard the singular values which are numerically zero
+   int k = 1;
+
+   while(k < S.size() && S(k) > 1.0e-12 * S(0))
+      ++k;
+
+   if(k < S.size()){
+
+      DArray<1> S_cut(k);
+      S_cut = S.subarray(shape(0),shape(k - 1));
+
+      DArray<4> U_cut(U.shape(0),U.shape(1),U.shape(2),k);
+      U_cut = U.subarray(shape(0,0,0,0),shape(U.shape(0) - 1,U.shape(1) - 1,U.shape(2) - 1,k - 1));
+
+      DArray<4> VT_cut(k,VT.shape(1),VT.shape(2),VT.shape(3));
+      VT_cut = VT.subarray(shape(0,0,0,0),shape(k - 1,VT.shape(1) - 1,VT.shape(2) - 1,VT.shape(3) - 1));
+
+      S = std::move(S_cut);
+      U = std::move(U_cut);
+      VT = std::move(VT_cut);
+
+   }
+
+   for(int i = 0;i < k;++i)
+      S(i) = 1.0/std::sqrt(S(i));
+
+   P_L[col].clear();
+   P_R[col].clear();
+
+   if(option == 'b'){
+
+      Contract(1.0,R,shape(0,1,2),VT,shape(1,2,3),0.0,P_L[col]);
+      Contract(1.0,U,shape(0,1,2),L,shape(0,1,2),0.0,P_R[col]);
+
+   }
+   else{
+
+      Contract(1.0,R,shape(3,4,5),VT,shape(1,2,3),0.0,P_L[col]);
+      Contract(1.0,U,shape(0,1,2),L,shape(3,4,5),0.0,P_R[col]);
+
+   }
+
+   Dimm(P_L[col],S);
+   Dimm(S,P_R[col]);
+
+}
+
+/**
+ * check if a top layer of env can be used as starting point for the peps
+ * @param row index of the top layer
+ * @param peps input PEPS<double>
+ * @param env Environment containing the layer
+ * @return true if the layer has the right number of sites and its physical legs fit the up legs of peps row 'row + 1'
+ */
+bool CTMRG::compatible(int row,const PEPS<double> &peps,const Environment &env) const {
+
+   const MPO<double> &layer = env.gt(row);
+
+   if(layer.size() != Lx)
+      return false;
+
+   for(int col = 0;col < Lx;++col){
+
+      if(layer[col].size() == 0)
+         return false;
+
+      if(layer[col].shape(1) != peps(row + 1,col).shape(1) || layer[col].shape(2) != peps(row + 1,col).shape(1))
+         return false;
+
+      if(col > 0 && layer[col].shape(0) != layer[col - 1].shape(3))
+         return false;
+
+   }
+
+   return layer[0].shape(0) == 1 && layer[Lx - 1].shape(3) == 1;
+
+}
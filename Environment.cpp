@@ -3,6 +3,9 @@
 #include <cmath>
 #include <vector>
 #include <complex>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
 #include <omp.h>
 
 using std::cout;
@@ -18,7 +21,21 @@ using namespace global;
 /** 
  * empty constructor
  */
-Environment::Environment(){ }
+Environment::Environment(){ 
+
+   method = 'M';
+   blocks = 1;
+
+   init = 'S';
+   fidelity = false;
+
+   init_time = 0.0;
+   init_count = 0;
+
+   init_fid = 0.0;
+   fid_count = 0;
+
+}
 
 /** 
  * constructor with allocation
@@ -31,10 +48,26 @@ Environment::Environment(int D_in,int D_aux_in,int comp_sweeps_in){
    t.resize(Ly - 2);
    b.resize(Ly - 2);
 
+   //nothing has been constructed yet
+   t_ver.resize(Ly - 2);
+   b_ver.resize(Ly - 2);
+
    D = D_in;
    D_aux = D_aux_in;
    comp_sweeps = comp_sweeps_in;
 
+   method = 'M';
+   blocks = 1;
+
+   init = 'S';
+   fidelity = false;
+
+   init_time = 0.0;
+   init_count = 0;
+
+   init_fid = 0.0;
+   fid_count = 0;
+
    //allocate the memory
    
    //bottom
@@ -76,13 +109,7 @@ Environment::Environment(int D_in,int D_aux_in,int comp_sweeps_in){
  */
 Environment::Environment(const Environment &env_copy){
 
-   t = env_copy.gt();
-   b = env_copy.gb();
-
-   D = env_copy.gD();
-   D_aux = env_copy.gD_aux();
-
-   comp_sweeps = env_copy.gcomp_sweeps();
+   *this = env_copy;
 
 }
 
@@ -91,6 +118,57 @@ Environment::Environment(const Environment &env_copy){
  */
 Environment::~Environment(){ }
 
+/**
+ * assignment: layers which are stored out-of-core in env_copy are read in and kept in a store of our own
+ */
+Environment &Environment::operator=(const Environment &env_copy){
+
+   if(this == &env_copy)
+      return *this;
+
+   store = env_copy.gstore();
+
+   int n = env_copy.gt().size();
+
+   t.resize(n);
+   b.resize(n);
+
+   for(int i = 0;i < n;++i){
+
+      t[i] = env_copy.gt(i);
+      this->load('t',i);
+
+      b[i] = env_copy.gb(i);
+      this->load('b',i);
+
+   }
+
+   t_ver = env_copy.t_ver;
+   b_ver = env_copy.b_ver;
+
+   D = env_copy.gD();
+   D_aux = env_copy.gD_aux();
+
+   comp_sweeps = env_copy.gcomp_sweeps();
+
+   method = env_copy.gmethod();
+   ctm = env_copy.gctm();
+
+   blocks = env_copy.gblocks();
+
+   init = env_copy.ginit();
+   fidelity = env_copy.fidelity;
+
+   init_time = env_copy.init_time;
+   init_count = env_copy.init_count;
+
+   init_fid = env_copy.init_fid;
+   fid_count = env_copy.fid_count;
+
+   return *this;
+
+}
+
 /**
  * construct the enviroment mps's for the input PEPS
  * @param option if 'L' construct full left environment
@@ -103,15 +181,39 @@ Environment::~Environment(){ }
  */
 void Environment::calc(const char option,PEPS<double> &peps){
 
-   if(option == 'A'){
+   PROFILE_SCOPE("calc");
 
-      b[0].fill('b',peps);
+   if(method == 'C'){
+
+      //CTMRG needs both sides: all layers are constructed together, starting from the previous top layers if there are any
+      bool warm = true;
+
+      for(int i = 0;i < Ly - 3;++i)
+         if(t_ver[i].empty())
+            warm = false;
+
+      std::chrono::steady_clock::time_point entered = std::chrono::steady_clock::now();
+
+      ctm.calc(peps,*this,warm);
+
+      telemetry::add("environment",std::chrono::duration<double>(std::chrono::steady_clock::now() - entered).count());
+
+      for(int i = 1;i < Ly - 2;++i)
+         this->stamp('b',i,peps);
+
+      for(int i = 0;i < Ly - 3;++i)
+         this->stamp('t',i,peps);
+
+   }
+   else if(option == 'A'){
+
+      this->fill('b',peps);
       b[0].canonicalize(Right,false);
 
       for(int i = 1;i < Ly - 2;++i)
          this->add_layer('b',i,peps);
 
-      t[Ly - 3].fill('t',peps);
+      this->fill('t',peps);
       t[Ly - 3].canonicalize(Right,false);
 
       for(int i = Ly - 4;i >= 0;--i)
@@ -120,7 +222,7 @@ void Environment::calc(const char option,PEPS<double> &peps){
    }
    else if(option == 'B'){
 
-      b[0].fill('b',peps);
+      this->fill('b',peps);
       b[0].canonicalize(Right,false);
 
       for(int i = 1;i < Ly - 2;++i)
@@ -129,7 +231,7 @@ void Environment::calc(const char option,PEPS<double> &peps){
    }
    else if(option == 'T'){
 
-      t[Ly - 3].fill('t',peps);
+      this->fill('t',peps);
       t[Ly - 3].canonicalize(Right,false);
 
       for(int i = Ly - 4;i >= 0;--i)
@@ -139,13 +241,253 @@ void Environment::calc(const char option,PEPS<double> &peps){
 
 }
 
+/**
+ * bring the enviroment up to date with the input PEPS: only the layers which depend on rows that have changed since they were constructed are recalculated
+ * @param option if 'T' update full top environment
+ *               if 'B' update full bottom environment
+ *               if 'A' update all environments
+ * @param peps input PEPS<double>
+ */
+void Environment::update(const char option,PEPS<double> &peps){
+
+   if(option == 'A' || option == 'B')
+      this->update('b',Ly - 3,peps);
+
+   if(option == 'A' || option == 'T')
+      this->update('t',0,peps);
+
+}
+
+/**
+ * make sure a single layer is up to date, together with all the layers it is built upon
+ * @param option 't'op or 'b'ottom
+ * @param row index of the layer needed
+ * @param peps input PEPS<double>
+ */
+void Environment::update(const char option,int row,PEPS<double> &peps){
+
+   if(method == 'C'){
+
+      //CTMRG layers depend on the whole lattice
+      bool fresh = true;
+
+      for(int i = 0;i < Ly - 2;++i)
+         if(this->stale('b',i,peps) || this->stale('t',i,peps))
+            fresh = false;
+
+      if(!fresh)
+         this->calc('A',peps);
+
+   }
+   else if(option == 'b'){
+
+      //find the first layer which is out of date
+      int start = 0;
+
+      while(start <= row && !this->stale('b',start,peps))
+         ++start;
+
+      if(start > row)
+         return;
+
+      if(start == 0){
+
+         this->fill('b',peps);
+         b[0].canonicalize(Right,false);
+
+         ++start;
+
+      }
+
+      for(int i = start;i <= row;++i)
+         this->add_layer('b',i,peps);
+
+   }
+   else{
+
+      int start = Ly - 3;
+
+      while(start >= row && !this->stale('t',start,peps))
+         --start;
+
+      if(start < row)
+         return;
+
+      if(start == Ly - 3){
+
+         this->fill('t',peps);
+         t[Ly - 3].canonicalize(Right,false);
+
+         --start;
+
+      }
+
+      for(int i = start;i >= row;--i)
+         this->add_layer('t',i,peps);
+
+   }
+
+}
+
+/**
+ * @param option 't'op or 'b'ottom
+ * @param row index of the layer
+ * @param peps the PEPS<double> the layer should describe
+ * @return true if the layer was not constructed from the current tensors of peps
+ */
+bool Environment::stale(const char option,int row,const PEPS<double> &peps) const {
+
+   if(option == 'b'){
+
+      if(b_ver[row].size() != row + 1)
+         return true;
+
+      for(int r = 0;r <= row;++r)
+         if(b_ver[row][r] != peps.gversion(r))
+            return true;
+
+   }
+   else{
+
+      if(t_ver[row].size() != Ly - row - 2)
+         return true;
+
+      for(int r = row + 2;r < Ly;++r)
+         if(t_ver[row][r - row - 2] != peps.gversion(r))
+            return true;
+
+   }
+
+   return false;
+
+}
+
+/**
+ * store the versions of the peps rows a layer was constructed from
+ * @param option 't'op or 'b'ottom
+ * @param row index of the layer
+ * @param peps the PEPS<double> the layer was constructed from
+ */
+void Environment::stamp(const char option,int row,const PEPS<double> &peps){
+
+   if(option == 'b'){
+
+      b_ver[row].resize(row + 1);
+
+      for(int r = 0;r <= row;++r)
+         b_ver[row][r] = peps.gversion(r);
+
+   }
+   else{
+
+      t_ver[row].resize(Ly - row - 2);
+
+      for(int r = row + 2;r < Ly;++r)
+         t_ver[row][r - row - 2] = peps.gversion(r);
+
+   }
+
+}
+
+/**
+ * fill the outer layer of the environment: no compression needed
+ * @param option 'b'ottom: fill b[0] with the bottom row, 't'op: fill t[Ly-3] with the top row
+ * @param peps input PEPS<double>
+ */
+void Environment::fill(const char option,const PEPS<double> &peps){
+
+   PROFILE_SCOPE("fill");
+
+   if(option == 'b'){
+
+      this->load('b',0);
+
+      b[0].fill('b',peps);
+      this->stamp('b',0,peps);
+
+   }
+   else{
+
+      this->load('t',Ly - 3);
+
+      t[Ly - 3].fill('t',peps);
+      this->stamp('t',Ly - 3,peps);
+
+   }
+
+}
+
+/**
+ * the double layer of a peps row has been multiplied with a constant: rescale the layers that contain it, so that they remain valid
+ * @param row the peps row that was rescaled
+ * @param factor the factor with which the double layer was multiplied (i.e. the square of the factor on the tensors)
+ * @param peps the rescaled PEPS<double>, only layers which are up to date with it are rescaled
+ */
+void Environment::scal_row(int row,double factor,const PEPS<double> &peps){
+
+   //layers which are stored out-of-core are scaled when they are read
+   for(int i = row;i < Ly - 2;++i)
+      if(!this->stale('b',i,peps)){
+
+         if(store.stored(Ly - 2 + i))
+            store.scal(Ly - 2 + i,factor);
+         else
+            b[i].scal(factor);
+
+      }
+
+   for(int i = 0;i <= row - 2;++i)
+      if(!this->stale('t',i,peps)){
+
+         if(store.stored(i))
+            store.scal(i,factor);
+         else
+            t[i].scal(factor);
+
+      }
+
+}
+
+/**
+ * the up bonds of a peps row have been multiplied with R factors by a QR from the row above, as in the canonicalization of the top rows
+ * (see propagate::shift_row). The bottom layer b[row] is transformed with them on its open bonds, the layers above it contain both rows and
+ * are invariant: all are stamped as up to date again. They have to be up to date before the shift.
+ * @param row the lower row of the shift
+ * @param R the R factors of every column (new bond,old bond)
+ * @param peps the PEPS<double> after the shift
+ */
+void Environment::gauge(int row,const vector< DArray<2> > &R,const PEPS<double> &peps){
+
+   enum {i,j,k,l,m,n};
+
+   if(row < Ly - 2){
+
+      this->load('b',row);
+
+      for(int col = 0;col < Lx;++col){
+
+         DArray<4> tmp;
+         Contract(1.0,R[col],shape(k,m),b[row][col],shape(i,m,n,j),0.0,tmp,shape(i,k,n,j));
+
+         b[row][col].clear();
+         Contract(1.0,R[col],shape(l,n),tmp,shape(i,k,n,j),0.0,b[row][col],shape(i,k,l,j));
+
+      }
+
+   }
+
+   for(int r = row;r < Ly - 2;++r)
+      this->stamp('b',r,peps);
+
+}
+
 /**
  * test if the enviroment is correctly contracted
  */
 void Environment::test(){
 
    for(int i = 0;i < Ly - 3;++i)
-      cout << i + 2 << "\t" << b[i + 1].dot(t[i]) << endl;
+      cout << i + 2 << "\t" << this->gb(i + 1).dot(this->gt(i)) << endl;
 
 }
 
@@ -156,6 +498,8 @@ void Environment::test(){
  */
 const MPO<double> &Environment::gt(int row) const {
 
+   this->load('t',row);
+
    return t[row];
 
 }
@@ -167,6 +511,8 @@ const MPO<double> &Environment::gt(int row) const {
  */
 MPO<double> &Environment::gt(int row) {
 
+   this->load('t',row);
+
    return t[row];
 
 }
@@ -178,6 +524,8 @@ MPO<double> &Environment::gt(int row) {
  */
 const MPO<double> &Environment::gb(int row) const {
 
+   this->load('b',row);
+
    return b[row];
 
 }
@@ -189,6 +537,8 @@ const MPO<double> &Environment::gb(int row) const {
  */
 MPO<double> &Environment::gb(int row) {
 
+   this->load('b',row);
+
    return b[row];
 
 }
@@ -240,7 +590,290 @@ void Environment::sD_aux(int D_aux_in) {
 }
 
 /**
- * @return the full bottom boundary 'MPO'
+ * @return the contraction method: 'M' for boundary 'MPO' compression, 'C' for CTMRG
+ */
+char Environment::gmethod() const {
+
+   return method;
+
+}
+
+/**
+ * set the contraction method
+ * @param method_in 'M' for boundary 'MPO' compression, 'C' for CTMRG
+ */
+void Environment::smethod(char method_in) {
+
+   method = method_in;
+
+}
+
+/**
+ * @return the CTMRG engine, access version
+ */
+CTMRG &Environment::gctm() {
+
+   return ctm;
+
+}
+
+/**
+ * @return the CTMRG engine, const version
+ */
+const CTMRG &Environment::gctm() const {
+
+   return ctm;
+
+}
+
+/**
+ * @return the nr of column blocks compressed in parallel
+ */
+int Environment::gblocks() const {
+
+   return blocks;
+
+}
+
+/**
+ * set the nr of column blocks compressed in parallel in add_layer. main leaves it at 1: bench_blocks compares the blocked sweeps with the
+ * serial ones, and they have to win there before they are worth an option
+ * @param blocks_in nr of blocks, 1 for the serial sweeps
+ */
+void Environment::sblocks(int blocks_in) {
+
+   blocks = blocks_in;
+
+}
+
+/**
+ * keep the layers out-of-core: at most 'capacity' layers are resident, the others are written to a memory mapped scratch file
+ * @param capacity maximal nr of resident layers (at least 4 are kept), 0 to keep all layers in memory
+ * @param dir directory in which the scratch file is created
+ */
+void Environment::sstore(int capacity,const std::string &dir){
+
+   int n = t.size();
+
+   //first bring everything back in memory
+   for(int i = 0;i < n;++i){
+
+      if(store.stored(i))
+         store.read(i,t[i]);
+
+      if(store.stored(n + i))
+         store.read(n + i,b[i]);
+
+   }
+
+   if(capacity == 0){
+
+      store = MPOStore();
+      return;
+
+   }
+
+   store = MPOStore(2*n,std::max(capacity,4),dir);
+
+   //register all layers, the ones which do not fit are written out. Layers which have not been constructed yet keep their
+   //allocated shape, MPO::fill writes in place
+   for(int i = 0;i < n;++i){
+
+      this->load('t',i);
+      this->load('b',i);
+
+   }
+
+}
+
+/**
+ * @return the out-of-core store of the layers
+ */
+const MPOStore &Environment::gstore() const {
+
+   return store;
+
+}
+
+/**
+ * make a layer resident if the store is used: reads it from the scratch file if necessary and writes out the least recently used layer
+ * @param option 't'op or 'b'ottom
+ * @param row index of the layer
+ */
+void Environment::load(const char option,int row) const {
+
+   if(store.gcapacity() == 0)
+      return;
+
+   int n = t.size();
+
+   int id = (option == 't') ? row : n + row;
+
+   MPO<double> &layer = (option == 't') ? t[row] : b[row];
+
+   if(store.stored(id))
+      store.read(id,layer);
+
+   int victim = store.touch(id);
+
+   if(victim >= 0){
+
+      MPO<double> &old = (victim < n) ? t[victim] : b[victim - n];
+      store.write(victim,old);
+
+   }
+
+}
+
+/**
+ * start reading a layer from the scratch file in the background, for a layer that will be needed soon
+ * @param option 't'op or 'b'ottom
+ * @param row index of the layer
+ */
+void Environment::prefetch(const char option,int row) const {
+
+   if(store.gcapacity() == 0)
+      return;
+
+   store.prefetch( (option == 't') ? row : t.size() + row );
+
+}
+
+/**
+ * append the layers to a buffer: for every t[i] and b[i] a flag telling whether it is up to date with peps, followed by its tensors
+ * @param buffer output: the layers are appended to it
+ * @param peps the PEPS<double> the layers are checked against
+ */
+void Environment::serialize(vector<char> &buffer,const PEPS<double> &peps) const {
+
+   int n = t.size();
+
+   checkpoint::put(buffer,(int32_t)n);
+
+   for(int i = 0;i < 2*n;++i){
+
+      char option = (i < n) ? 't' : 'b';
+      int row = i % n;
+
+      const MPO<double> &layer = (option == 't') ? this->gt(row) : this->gb(row);
+
+      checkpoint::put(buffer,(int32_t)!this->stale(option,row,peps));
+      checkpoint::put(buffer,(int32_t)layer.size());
+
+      for(int col = 0;col < layer.size();++col)
+         checkpoint::put(buffer,layer[col]);
+
+   }
+
+}
+
+/**
+ * read the layers written by serialize, layers which were up to date are marked as constructed from peps
+ * @param block pointer to the layers
+ * @param peps the PEPS<double> the layers were written with, already read in
+ * @return nr of bytes read
+ */
+size_t Environment::deserialize(const char *block,const PEPS<double> &peps){
+
+   const char *ptr = block;
+
+   int32_t n;
+   checkpoint::get(ptr,n);
+
+   //not BTAS_THROW: this has to be checked in optimized builds as well
+   if(n != t.size())
+      throw std::runtime_error("Environment::deserialize: nr of layers does not match");
+
+   for(int i = 0;i < 2*n;++i){
+
+      char option = (i < n) ? 't' : 'b';
+      int row = i % n;
+
+      MPO<double> &layer = (option == 't') ? this->gt(row) : this->gb(row);
+
+      int32_t valid,size;
+
+      checkpoint::get(ptr,valid);
+      checkpoint::get(ptr,size);
+
+      layer.resize(size);
+
+      for(int col = 0;col < size;++col)
+         checkpoint::get(ptr,layer[col]);
+
+      if(valid)
+         this->stamp(option,row,peps);
+      else if(option == 't')
+         t_ver[row].clear();
+      else
+         b_ver[row].clear();
+
+   }
+
+   return ptr - block;
+
+}
+
+/**
+ * @return the initial guess of new layers: 'S' truncated svd's, 'Z' zip-up with randomized QR projections, 'P' the previous layer
+ */
+char Environment::ginit() const {
+
+   return init;
+
+}
+
+/**
+ * set the initial guess of new layers
+ * @param init_in 'S' truncated svd's, 'Z' zip-up with randomized QR projections, 'P' the previous layer, svd's if there is none
+ */
+void Environment::sinit(char init_in) {
+
+   init = init_in;
+
+}
+
+/**
+ * @param fidelity_in if true the fidelity of every initial guess with the compressed layer is measured, this costs an extra copy and overlap per layer
+ */
+void Environment::sfidelity(bool fidelity_in) {
+
+   fidelity = fidelity_in;
+
+}
+
+/**
+ * @return the total wall time in seconds spent in the initialization of new layers
+ */
+double Environment::ginit_time() const {
+
+   return init_time;
+
+}
+
+/**
+ * @return the nr of layers which have been initialized
+ */
+int Environment::ginit_count() const {
+
+   return init_count;
+
+}
+
+/**
+ * @return the average fidelity of the initial guesses with the compressed layers, -1 if nothing was measured
+ */
+double Environment::ginit_fidelity() const {
+
+   if(fid_count == 0)
+      return -1.0;
+
+   return init_fid / (double) fid_count;
+
+}
+
+/**
+ * @return the full bottom boundary 'MPO', when the store is used only the resident layers are filled
  */
 const vector< MPO<double> > &Environment::gb() const {
 
@@ -249,7 +882,7 @@ const vector< MPO<double> > &Environment::gb() const {
 }
 
 /**
- * @return the full top boundary 'MPO'
+ * @return the full top boundary 'MPO', when the store is used only the resident layers are filled
  */
 const vector< MPO<double> > &Environment::gt() const {
 
@@ -265,8 +898,55 @@ const vector< MPO<double> > &Environment::gt() const {
  */
 void Environment::add_layer(const char option,int row,PEPS<double> &peps){
 
-   //initialize using svd: output is right normalized b/t[row]
-   init_svd(option,row,peps);
+   PROFILE_SCOPE("add_layer");
+   FOOTPRINT_TAG("add_layer");
+
+   std::chrono::steady_clock::time_point entered = std::chrono::steady_clock::now();
+
+   if(option == 'b')
+      this->load('b',row - 1);
+   else
+      this->load('t',row + 1);
+
+   this->load(option,row);
+
+   if(method == 'C'){
+
+      //single CTMRG move, closed by the present layer on the other side
+      ctm.move(option,row,peps,*this);
+      this->stamp(option,row,peps);
+
+      telemetry::add("environment",std::chrono::duration<double>(std::chrono::steady_clock::now() - entered).count());
+
+      return;
+
+   }
+
+   //initial guess: output is right normalized b/t[row]
+   std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+   this->init_layer(option,row,peps);
+
+   std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+
+   init_time += std::chrono::duration_cast< std::chrono::duration<double> >(stop - start).count();
+   ++init_count;
+
+   MPO<double> guess;
+
+   if(fidelity)
+      guess = (option == 'b') ? b[row] : t[row];
+
+   int sweeps = comp_sweeps;
+
+   if(blocks > 1 && Lx >= 4){
+
+      //parallel sweeps over the column blocks, the serial sweep afterwards repairs the block edges
+      this->compress_blocks(option,row,peps);
+
+      sweeps = 1;
+
+   }
 
    if(option == 'b'){
 
@@ -303,7 +983,7 @@ void Environment::add_layer(const char option,int row,PEPS<double> &peps){
 
       int iter = 0;
 
-      while(iter < comp_sweeps){
+      while(iter < sweeps){
 
 #ifdef _DEBUG
          cout << iter  << "\t" << cost_function('b',row,0,peps,R) << endl;
@@ -384,6 +1064,8 @@ void Environment::add_layer(const char option,int row,PEPS<double> &peps){
       //then multiply the norm over the whole chain
       b[row].scal(nrm);
 
+      this->stamp('b',row,peps);
+
    }
    else{
 
@@ -423,7 +1105,7 @@ void Environment::add_layer(const char option,int row,PEPS<double> &peps){
 
       int iter = 0;
 
-      while(iter < comp_sweeps){
+      while(iter < sweeps){
 
 #ifdef _DEBUG
          cout << iter  << "\t" << cost_function('t',row,0,peps,R) << endl;
@@ -503,8 +1185,389 @@ void Environment::add_layer(const char option,int row,PEPS<double> &peps){
       //then multiply the norm over the whole chain
       t[row].scal(nrm);
 
+      this->stamp('t',row,peps);
+
+   }
+
+   if(fidelity){
+
+      const MPO<double> &layer = (option == 'b') ? b[row] : t[row];
+
+      init_fid += std::fabs(guess.dot(layer)) / std::sqrt(guess.dot(guess) * layer.dot(layer));
+      ++fid_count;
+
+   }
+
+   telemetry::add("environment",std::chrono::duration<double>(std::chrono::steady_clock::now() - entered).count());
+
+}
+
+/**
+ * parallel version of the variational compression in add_layer: the row is split into column blocks which are swept simultaneously.
+ * Every block sees the rest of the chain through the overlap and norm operators on its edges, which are exchanged between neighbouring
+ * blocks after every sweep. Since the blocks are not in a common canonical form, the local problems are solved with the
+ * pseudo-inverses of the norm operators. Every norm operator is used on the way right and on the way back, so its pseudo-inverse is
+ * calculated once, when the operator is made. On exit b/t[row] is right canonical.
+ * @param option 't'op or 'b'ottom
+ * @param row row index
+ * @param peps the input PEPS<double> object 
+ */
+void Environment::compress_blocks(const char option,int row,const PEPS<double> &peps){
+
+   MPO<double> &layer = (option == 'b') ? b[row] : t[row];
+
+   //blocks contain at least two columns
+   int nb = std::min(blocks,Lx/2);
+
+   vector<int> edge(nb + 1);
+
+   for(int k = 0;k <= nb;++k)
+      edge[k] = (k*Lx)/nb;
+
+   //overlap operators with the uncompressed layer and norm operators: index i lives on the bond left of column i
+   vector< DArray<4> > OL(Lx + 1);
+   vector< DArray<4> > OR(Lx + 1);
+
+   vector< DArray<2> > GL(Lx + 1);
+   vector< DArray<2> > GR(Lx + 1);
+
+   OL[0].resize(1,1,1,1);
+   OL[0] = 1.0;
+
+   GL[0].resize(1,1);
+   GL[0] = 1.0;
+
+   OR[Lx].resize(1,1,1,1);
+   OR[Lx] = 1.0;
+
+   GR[Lx].resize(1,1);
+   GR[Lx] = 1.0;
+
+   //the operators of the initial guess have to be constructed serially
+   for(int col = Lx - 1;col > 0;--col){
+
+      this->env_R(option,row,col,peps,layer[col],OR[col + 1],OR[col]);
+
+      DArray<4> tmp4;
+      Contract(1.0,layer[col],shape(3),GR[col + 1],shape(0),0.0,tmp4);
+
+      Contract(1.0,tmp4,shape(1,2,3),layer[col],shape(1,2,3),0.0,GR[col]);
+
+   }
+
+   for(int col = 0;col < Lx - 1;++col){
+
+      DArray<6> tmp6;
+      this->target(option,row,col,peps,OL[col],tmp6);
+
+      Contract(1.0,tmp6,shape(0,2,4),layer[col],shape(0,1,2),0.0,OL[col + 1]);
+
+      DArray<4> tmp4;
+      Contract(1.0,GL[col],shape(0),layer[col],shape(0),0.0,tmp4);
+
+      Contract(1.0,tmp4,shape(0,1,2),layer[col],shape(0,1,2),0.0,GL[col + 1]);
+
+   }
+
+   //pseudo-inverses of the norm operators
+   vector< DArray<2> > GL_inv(Lx + 1);
+   vector< DArray<2> > GR_inv(Lx + 1);
+
+   for(int col = 1;col < Lx;++col)
+      this->pseudo_inverse(GR[col],GR_inv[col]);
+
+   //operators on the edges of the blocks, as seen by the block (in) and as produced by its neighbour (out)
+   vector< DArray<4> > OL_in(nb),OR_in(nb),OL_out(nb),OR_out(nb);
+   vector< DArray<2> > GL_in(nb),GR_in(nb),GL_out(nb),GR_out(nb);
+   vector< DArray<2> > GL_in_inv(nb),GR_in_inv(nb),GL_out_inv(nb),GR_out_inv(nb);
+
+   for(int k = 0;k < nb;++k){
+
+      OL_in[k] = OL[edge[k]];
+      GL_in[k] = GL[edge[k]];
+
+      OR_in[k] = OR[edge[k + 1]];
+      GR_in[k] = GR[edge[k + 1]];
+
+      this->pseudo_inverse(GL_in[k],GL_in_inv[k]);
+      this->pseudo_inverse(GR_in[k],GR_in_inv[k]);
+
+   }
+
+   for(int iter = 0;iter < comp_sweeps;++iter){
+
+#pragma omp parallel for schedule(static,1)
+      for(int k = 0;k < nb;++k){
+
+         int first = edge[k];
+         int last = edge[k + 1] - 1;
+
+         //two neighbouring blocks never update both sides of the bond between them at the same time:
+         //alternately the last or the first site of a block is kept fixed during a sweep
+         int frozen = -1;
+
+         if(iter % 2 == 0 && k < nb - 1)
+            frozen = last;
+         else if(iter % 2 == 1 && k > 0)
+            frozen = first;
+
+         //rightgoing sweep through the block
+         for(int i = first;i <= last;++i){
+
+            const DArray<4> &ol = (i == first) ? OL_in[k] : OL[i];
+            const DArray<2> &gl = (i == first) ? GL_in[k] : GL[i];
+            const DArray<2> &gl_inv = (i == first) ? GL_in_inv[k] : GL_inv[i];
+
+            const DArray<4> &orr = (i == last) ? OR_in[k] : OR[i + 1];
+            const DArray<2> &grr = (i == last) ? GR_in[k] : GR[i + 1];
+            const DArray<2> &gr_inv = (i == last) ? GR_in_inv[k] : GR_inv[i + 1];
+
+            DArray<6> tmp6;
+            this->target(option,row,i,peps,ol,tmp6);
+
+            DArray<4> tmp4;
+
+            if(i != frozen){
+
+               //solve gl * layer[i] * gr = overlap
+               Contract(1.0,tmp6,shape(1,3,5),orr,shape(0,1,2),0.0,tmp4);
+
+               DArray<4> tmp4bis;
+               Contract(1.0,gl_inv,shape(1),tmp4,shape(0),0.0,tmp4bis);
+
+               layer[i].clear();
+               Contract(1.0,tmp4bis,shape(3),gr_inv,shape(0),0.0,layer[i]);
+
+            }
+
+            if(i < last){
+
+               //QR inside the block
+               DArray<2> tmp2;
+               Geqrf(layer[i],tmp2);
+
+               tmp4.clear();
+               Contract(1.0,tmp2,shape(1),layer[i + 1],shape(0),0.0,tmp4);
+
+               layer[i + 1] = std::move(tmp4);
+
+            }
+            else if(k == nb - 1)
+               continue;
+
+            DArray<4> &ol_next = (i == last) ? OL_out[k] : OL[i + 1];
+            DArray<2> &gl_next = (i == last) ? GL_out[k] : GL[i + 1];
+
+            ol_next.clear();
+            Contract(1.0,tmp6,shape(0,2,4),layer[i],shape(0,1,2),0.0,ol_next);
+
+            tmp4.clear();
+            Contract(1.0,gl,shape(0),layer[i],shape(0),0.0,tmp4);
+
+            gl_next.clear();
+            Contract(1.0,tmp4,shape(0,1,2),layer[i],shape(0,1,2),0.0,gl_next);
+
+            this->pseudo_inverse(gl_next,(i == last) ? GL_out_inv[k] : GL_inv[i + 1]);
+
+         }
+
+         //back to the beginning of the block with a leftgoing sweep
+         for(int i = last;i >= first;--i){
+
+            const DArray<4> &ol = (i == first) ? OL_in[k] : OL[i];
+            const DArray<2> &gl = (i == first) ? GL_in[k] : GL[i];
+            const DArray<2> &gl_inv = (i == first) ? GL_in_inv[k] : GL_inv[i];
+
+            const DArray<4> &orr = (i == last) ? OR_in[k] : OR[i + 1];
+            const DArray<2> &grr = (i == last) ? GR_in[k] : GR[i + 1];
+            const DArray<2> &gr_inv = (i == last) ? GR_in_inv[k] : GR_inv[i + 1];
+
+            DArray<6> tmp6;
+            this->target(option,row,i,peps,ol,tmp6);
+
+            DArray<4> tmp4;
+
+            if(i != frozen){
+
+               //solve gl * layer[i] * gr = overlap
+               Contract(1.0,tmp6,shape(1,3,5),orr,shape(0,1,2),0.0,tmp4);
+
+               DArray<4> tmp4bis;
+               Contract(1.0,gl_inv,shape(1),tmp4,shape(0),0.0,tmp4bis);
+
+               layer[i].clear();
+               Contract(1.0,tmp4bis,shape(3),gr_inv,shape(0),0.0,layer[i]);
+
+            }
+
+            if(i > first){
+
+               //LQ inside the block
+               DArray<2> tmp2;
+               Gelqf(tmp2,layer[i]);
+
+               tmp4.clear();
+               Gemm(CblasNoTrans,CblasNoTrans,1.0,layer[i - 1],tmp2,0.0,tmp4);
+
+               layer[i - 1] = std::move(tmp4);
+
+            }
+            else if(k == 0)
+               continue;
+
+            DArray<4> &or_next = (i == first) ? OR_out[k] : OR[i];
+            DArray<2> &gr_next = (i == first) ? GR_out[k] : GR[i];
+
+            or_next.clear();
+            this->env_R(option,row,i,peps,layer[i],orr,or_next);
+
+            tmp4.clear();
+            Contract(1.0,layer[i],shape(3),grr,shape(0),0.0,tmp4);
+
+            gr_next.clear();
+            Contract(1.0,tmp4,shape(1,2,3),layer[i],shape(1,2,3),0.0,gr_next);
+
+            this->pseudo_inverse(gr_next,(i == first) ? GR_out_inv[k] : GR_inv[i]);
+
+         }
+
+      }
+
+      //exchange the edge operators between neighbouring blocks
+      for(int k = 0;k < nb - 1;++k){
+
+         OL_in[k + 1] = std::move(OL_out[k]);
+         GL_in[k + 1] = std::move(GL_out[k]);
+         GL_in_inv[k + 1] = std::move(GL_out_inv[k]);
+
+         OR_in[k] = std::move(OR_out[k + 1]);
+         GR_in[k] = std::move(GR_out[k + 1]);
+         GR_in_inv[k] = std::move(GR_out_inv[k + 1]);
+
+      }
+
+   }
+
+   //right canonical, norm redistributed over the chain
+   layer.canonicalize(Right,false);
+
+}
+
+/**
+ * contract the uncompressed layer on column col with the left overlap operator: the object from which the local compression problem
+ * and the next left operator are obtained
+ * @param option 't'op or 'b'ottom
+ * @param row row index of the layer
+ * @param col column index
+ * @param peps the input PEPS<double> object 
+ * @param OL left overlap operator on the bond left of col
+ * @param tmp6 output object
+ */
+void Environment::target(const char option,int row,int col,const PEPS<double> &peps,const DArray<4> &OL,DArray<6> &tmp6) const {
+
+   tmp6.clear();
+
+   if(option == 'b'){
+
+      DArray<6> tmp6bis;
+      Contract(1.0,OL,shape(0),b[row - 1][col],shape(0),0.0,tmp6bis);
+
+      DArray<7> tmp7;
+      Contract(1.0,tmp6bis,shape(0,3),peps(row,col),shape(0,3),0.0,tmp7);
+
+      Contract(1.0,tmp7,shape(0,2,5),peps(row,col),shape(0,3,2),0.0,tmp6);
+
+   }
+   else{
+
+      //peps index is row+2!
+      int prow = row + 2;
+
+      DArray<6> tmp6bis;
+      Contract(1.0,OL,shape(0),t[row + 1][col],shape(0),0.0,tmp6bis);
+
+      DArray<7> tmp7;
+      Contract(1.0,tmp6bis,shape(0,3),peps(prow,col),shape(0,1),0.0,tmp7);
+
+      Contract(1.0,tmp7,shape(0,2,4),peps(prow,col),shape(0,1,2),0.0,tmp6);
+
+   }
+
+}
+
+/**
+ * construct the right overlap operator on the bond left of col from the one on the bond right of it
+ * @param option 't'op or 'b'ottom
+ * @param row row index of the layer
+ * @param col column index
+ * @param peps the input PEPS<double> object 
+ * @param site compressed tensor on col
+ * @param OR right overlap operator on the bond right of col
+ * @param OR_new output: right overlap operator on the bond left of col
+ */
+void Environment::env_R(const char option,int row,int col,const PEPS<double> &peps,const DArray<4> &site,const DArray<4> &OR,DArray<4> &OR_new) const {
+
+   DArray<6> tmp6;
+   DArray<7> tmp7;
+
+   if(option == 'b'){
+
+      Contract(1.0,b[row - 1][col],shape(3),OR,shape(0),0.0,tmp6);
+
+      Contract(1.0,tmp6,shape(1,3),peps(row,col),shape(3,4),0.0,tmp7);
+
+      tmp6.clear();
+      Contract(1.0,tmp7,shape(1,2,6),peps(row,col),shape(3,4,2),0.0,tmp6);
+
+   }
+   else{
+
+      //peps index is row+2!
+      int prow = row + 2;
+
+      Contract(1.0,t[row + 1][col],shape(3),OR,shape(0),0.0,tmp6);
+
+      Contract(1.0,tmp6,shape(1,3),peps(prow,col),shape(1,4),0.0,tmp7);
+
+      tmp6.clear();
+      Contract(1.0,tmp7,shape(1,5,2),peps(prow,col),shape(1,2,4),0.0,tmp6);
+
+   }
+
+   Contract(1.0,tmp6,shape(3,5,1),site,shape(1,2,3),0.0,OR_new);
+
+}
+
+/**
+ * pseudo-inverse of a symmetric positive semi-definite matrix, eigenvalues smaller than 1e-12 times the largest one are discarded
+ * @param G input matrix
+ * @param G_inv output: pseudo-inverse of G
+ */
+void Environment::pseudo_inverse(const DArray<2> &G,DArray<2> &G_inv) const {
+
+   DArray<1> eig;
+   DArray<2> V;
+
+   Syev('V','U',G,eig,V);
+
+   //eigenvalues are in ascending order
+   double max = eig(eig.size() - 1);
+
+   for(int i = 0;i < eig.size();++i){
+
+      if(eig(i) > 1.0e-12 * max)
+         eig(i) = 1.0/eig(i);
+      else
+         eig(i) = 0.0;
+
    }
 
+   DArray<2> tmp2(V);
+   Dimm(tmp2,eig);
+
+   G_inv.clear();
+   Gemm(CblasNoTrans,CblasTrans,1.0,tmp2,V,0.0,G_inv);
+
 }
 
 /**
@@ -516,6 +1579,13 @@ void Environment::add_layer(const char option,int row,PEPS<double> &peps){
  */
 double Environment::cost_function(const char option,int row,int col,const PEPS<double> &peps,const std::vector< DArray<4> > &R){
 
+   if(option == 'b')
+      this->load('b',row - 1);
+   else
+      this->load('t',row + 1);
+
+   this->load(option,row);
+
    if(option == 'b'){
 
       //environment of b is completely unitary
@@ -567,6 +1637,102 @@ double Environment::cost_function(const char option,int row,int col,const PEPS<d
 
 }
 
+/**
+ * construct the initial guess of the layer on 'row' for the variational compression, output is right canonical
+ * @param option 'b'ottom or 't'op environment
+ * @param row index of the row to be added into the environment
+ * @param peps the input PEPS<double> object
+ */
+void Environment::init_layer(const char option,int row,const PEPS<double> &peps){
+
+   if(init == 'P'){
+
+      MPO<double> &layer = (option == 'b') ? b[row] : t[row];
+
+      //a layer from an earlier PEPS is only a good guess if it was constructed with the present auxiliary dimension
+      bool prev = (option == 'b') ? !b_ver[row].empty() : !t_ver[row].empty();
+
+      for(int col = 1;col < Lx;++col)
+         if(layer[col].shape(0) > D_aux)
+            prev = false;
+
+      if(prev){
+
+         layer.canonicalize(Right,false);
+         return;
+
+      }
+
+   }
+
+   this->init_svd(option,row,peps);
+
+}
+
+/**
+ * truncate a column of the zip-up in init_svd to dimension D_aux: A = U * VT with U left-unitary. With init == 'Z' the column space of A is
+ * found with a randomized projection and one power iteration, which only needs matrix products and QR decompositions,
+ * otherwise the truncated svd is used and the singular values are pasted to VT.
+ * @param A input rank-6 object, the first three legs are the rows: destroyed on output
+ * @param U output: left-unitary part
+ * @param VT output: rest of the object, to be carried on to the next column
+ */
+void Environment::truncate(DArray<6> &A,DArray<4> &U,DArray<4> &VT) const {
+
+   //the weight of A, to measure the discarded part: U has orthonormal columns, so the kept weight is that of VT on exit
+   double weight = telemetry::active() ? Dot(A,A) : 0.0;
+
+   if(init != 'Z'){
+
+      DArray<1> S;
+      Gesvd('S','S',A,S,U,VT,D_aux);
+
+      Dimm(S,VT);
+
+      if(weight > 0.0)
+         telemetry::maximum("truncation",1.0 - Dot(VT,VT) / weight);
+
+      return;
+
+   }
+
+   int m = A.shape(0) * A.shape(1) * A.shape(2);
+   int n = A.shape(3) * A.shape(4) * A.shape(5);
+
+   int k = std::min(D_aux,std::min(m,n));
+
+   //random test vectors on the column space
+   DArray<4> Omega(A.shape(3),A.shape(4),A.shape(5),k);
+   Omega.generate(rgen<double>);
+
+   U.clear();
+   Gemm(CblasNoTrans,CblasNoTrans,1.0,A,Omega,0.0,U);
+
+   DArray<2> R;
+   Geqrf(U,R);
+
+   //power iteration: suppresses the discarded part of the spectrum
+   Omega.clear();
+   Gemm(CblasTrans,CblasNoTrans,1.0,A,U,0.0,Omega);
+
+   R.clear();
+   Geqrf(Omega,R);
+
+   U.clear();
+   Gemm(CblasNoTrans,CblasNoTrans,1.0,A,Omega,0.0,U);
+
+   R.clear();
+   Geqrf(U,R);
+
+   //project
+   VT.clear();
+   Gemm(CblasTrans,CblasNoTrans,1.0,U,A,0.0,VT);
+
+   if(weight > 0.0)
+      telemetry::maximum("truncation",1.0 - Dot(VT,VT) / weight);
+
+}
+
 /**
  * initialize the environment on 'row' by performing an svd-compression on the 'full' environment b[row-1] * peps(row,...) * peps(row,...)
  * output is right canonical, which is needed for the compression algorithm!
@@ -575,6 +1741,13 @@ double Environment::cost_function(const char option,int row,int col,const PEPS<d
  */
 void Environment::init_svd(char option,int row,const PEPS<double> &peps){
 
+   if(option == 'b')
+      this->load('b',row - 1);
+   else
+      this->load('t',row + 1);
+
+   this->load(option,row);
+
    if(option == 'b'){
 
       //first (leftmost) site
@@ -587,14 +1760,11 @@ void Environment::init_svd(char option,int row,const PEPS<double> &peps){
       DArray<6> tmp6bis;
       Permute(tmp6,shape(0,1,3,2,4,5),tmp6bis);
 
-      //now svd the large object
+      //now truncate the large object, S is pasted to VT for the next iteration
       DArray<1> S;
       DArray<4> VT;
 
-      Gesvd('S','S',tmp6bis,S,b[row][0],VT,D_aux);
-
-      //paste S to VT for next iteration
-      Dimm(S,VT);
+      this->truncate(tmp6bis,b[row][0],VT);
 
       for(int col = 1;col < Lx - 1;++col){
 
@@ -614,14 +1784,10 @@ void Environment::init_svd(char option,int row,const PEPS<double> &peps){
          tmp6bis.clear();
          Permute(tmp6,shape(0,2,4,3,5,1),tmp6bis);
 
-         //and svd!
-         S.clear();
+         //and truncate!
          VT.clear();
 
-         Gesvd('S','S',tmp6bis,S,b[row][col],VT,D_aux);
-
-         //paste S to VT for next iteration
-         Dimm(S,VT);
+         this->truncate(tmp6bis,b[row][col],VT);
 
       }
 
@@ -695,14 +1861,11 @@ void Environment::init_svd(char option,int row,const PEPS<double> &peps){
       DArray<6> tmp6bis;
       Permute(tmp6,shape(3,1,4,0,2,5),tmp6bis);
 
-      //now svd the large object
+      //now truncate the large object, S is pasted to VT for the next iteration
       DArray<1> S;
       DArray<4> VT;
 
-      Gesvd('S','S',tmp6bis,S,t[row][0],VT,D_aux);
-
-      //paste S to VT for next iteration
-      Dimm(S,VT);
+      this->truncate(tmp6bis,t[row][0],VT);
 
       for(int col = 1;col < Lx - 1;++col){
 
@@ -722,14 +1885,10 @@ void Environment::init_svd(char option,int row,const PEPS<double> &peps){
          tmp6bis.clear();
          Permute(tmp6,shape(0,2,4,1,3,5),tmp6bis);
 
-         //and svd!
-         S.clear();
+         //and truncate!
          VT.clear();
 
-         Gesvd('S','S',tmp6bis,S,t[row][col],VT,D_aux);
-
-         //paste S to VT for next iteration
-         Dimm(S,VT);
+         this->truncate(tmp6bis,t[row][col],VT);
 
       }
 
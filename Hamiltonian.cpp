@@ -31,6 +31,10 @@ Hamiltonian::Hamiltonian(const Hamiltonian &ham_c){
    this->coef_n = ham_c.gcoef_n();
    this->coef_nn = ham_c.gcoef_nn();
 
+   this->L_stack = ham_c.gL_stack();
+   this->R_n = ham_c.gR_n();
+   this->R_nn = ham_c.gR_nn();
+
 }
 
 /**
@@ -123,6 +127,33 @@ const std::vector< DArray<2> > &Hamiltonian::gR() const {
 
 }
 
+/**
+ * @return the 'delta' left operators stacked in one tensor (i,phys_out,phys_in)
+ */
+const DArray<3> &Hamiltonian::gL_stack() const {
+
+   return L_stack;
+
+}
+
+/**
+ * @return the 'delta' right operators stacked in one tensor (i,phys_out,phys_in), operator i multiplied with coef_n[i]
+ */
+const DArray<3> &Hamiltonian::gR_n() const {
+
+   return R_n;
+
+}
+
+/**
+ * @return the 'delta' right operators stacked in one tensor (i,phys_out,phys_in), operator i multiplied with coef_nn[i]
+ */
+const DArray<3> &Hamiltonian::gR_nn() const {
+
+   return R_nn;
+
+}
+
 /**
  * initialize the operators on the nn-Heisenberg model
  * @param ladder if true, use ladder operators (+,-,z), if false, use x,y,z
@@ -223,4 +254,20 @@ void Hamiltonian::set_J1J2(bool ladder) {
 
    }
 
+   //stacked operators, for the batched evaluation of all terms at once
+   L_stack.resize(delta,global::d,global::d);
+   R_n.resize(delta,global::d,global::d);
+   R_nn.resize(delta,global::d,global::d);
+
+   for(int i = 0;i < delta;++i)
+      for(int s = 0;s < global::d;++s)
+         for(int t = 0;t < global::d;++t){
+
+            L_stack(i,s,t) = L[i](s,t);
+
+            R_n(i,s,t) = coef_n[i] * R[i](s,t);
+            R_nn(i,s,t) = coef_nn[i] * R[i](s,t);
+
+         }
+
 }
@@ -0,0 +1,331 @@
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <list>
+#include <string>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+#include "include.h"
+
+/**
+ * empty constructor: no out-of-core storage
+ */
+MPOStore::MPOStore(){
+
+   capacity = 0;
+   fd = -1;
+   length = 0;
+
+}
+
+/**
+ * constructor
+ * @param n nr of layers which are managed
+ * @param capacity_in maximal nr of layers kept in memory, 0 to keep everything in memory
+ * @param dir_in directory of the scratch file
+ */
+MPOStore::MPOStore(int n,int capacity_in,const std::string &dir_in){
+
+   capacity = capacity_in;
+   dir = dir_in;
+
+   fd = -1;
+   length = 0;
+
+   offset.resize(n,0);
+   bytes.resize(n,0);
+   reserved.resize(n,0);
+
+   shapes.resize(n);
+   factor.resize(n,1.0);
+
+   on_disk.resize(n,false);
+   in_memory.resize(n,false);
+
+}
+
+/**
+ * copy constructor: only the settings are copied, the copy gets its own scratch file
+ */
+MPOStore::MPOStore(const MPOStore &store_copy){
+
+   fd = -1;
+   length = 0;
+
+   *this = store_copy;
+
+}
+
+/**
+ * destructor: close the scratch file
+ */
+MPOStore::~MPOStore(){
+
+   if(fd != -1)
+      close(fd);
+
+}
+
+/**
+ * assignment: only the settings are copied, nothing is stored or resident in the result
+ */
+MPOStore &MPOStore::operator=(const MPOStore &store_copy){
+
+   if(this == &store_copy)
+      return *this;
+
+   if(fd != -1)
+      close(fd);
+
+   fd = -1;
+   length = 0;
+
+   capacity = store_copy.gcapacity();
+   dir = store_copy.gdir();
+
+   int n = store_copy.offset.size();
+
+   offset.assign(n,0);
+   bytes.assign(n,0);
+   reserved.assign(n,0);
+
+   shapes.assign(n,vector< IVector<4> >());
+   factor.assign(n,1.0);
+
+   on_disk.assign(n,false);
+   in_memory.assign(n,false);
+
+   lru.clear();
+
+   return *this;
+
+}
+
+/**
+ * @return the maximal nr of resident layers, 0 if all layers stay in memory
+ */
+int MPOStore::gcapacity() const {
+
+   return capacity;
+
+}
+
+/**
+ * @return the directory of the scratch file
+ */
+const std::string &MPOStore::gdir() const {
+
+   return dir;
+
+}
+
+/**
+ * @param id layer index
+ * @return true if the layer is registered as resident, or if there is no out-of-core storage
+ */
+bool MPOStore::resident(int id) const {
+
+   if(capacity == 0)
+      return true;
+
+   return in_memory[id];
+
+}
+
+/**
+ * @param id layer index
+ * @return true if the layer has been written to the scratch file and is not resident
+ */
+bool MPOStore::stored(int id) const {
+
+   if(capacity == 0)
+      return false;
+
+   return on_disk[id] && !in_memory[id];
+
+}
+
+/**
+ * create and unlink the scratch file
+ */
+void MPOStore::open(){
+
+   std::string name = dir + "/peps_env_XXXXXX";
+
+   vector<char> tmpl(name.begin(),name.end());
+   tmpl.push_back('\0');
+
+   fd = mkstemp(tmpl.data());
+
+   //not BTAS_THROW: this has to be checked in optimized builds as well
+   if(fd == -1)
+      throw std::runtime_error("MPOStore::open: could not create scratch file in " + dir);
+
+   unlink(tmpl.data());
+
+}
+
+/**
+ * mark a layer as most recently used
+ * @param id layer index
+ * @return the index of the least recently used layer if there are too many resident layers now, -1 otherwise. That layer has to be written.
+ */
+int MPOStore::touch(int id){
+
+   if(in_memory[id])
+      lru.remove(id);
+
+   lru.push_front(id);
+   in_memory[id] = true;
+
+   if(capacity > 0 && lru.size() > capacity)
+      return lru.back();
+
+   return -1;
+
+}
+
+/**
+ * write a layer to the scratch file and release its memory
+ * @param id layer index
+ * @param layer the layer, its tensors are cleared on exit
+ */
+void MPOStore::write(int id,MPO<double> &layer){
+
+   if(fd == -1)
+      this->open();
+
+   size_t size = 0;
+
+   shapes[id].resize(layer.size());
+
+   for(int col = 0;col < layer.size();++col){
+
+      shapes[id][col] = layer[col].shape();
+      size += layer[col].size() * sizeof(double);
+
+   }
+
+   size_t page = sysconf(_SC_PAGESIZE);
+
+   //new region at the end of the file if the old one is too small
+   if(size > reserved[id]){
+
+      reserved[id] = ((size + page - 1)/page) * page;
+
+      offset[id] = length;
+      length += reserved[id];
+
+      int info = ftruncate(fd,length);
+
+      if(info != 0)
+         throw std::runtime_error("MPOStore::write: could not grow scratch file");
+
+   }
+
+   bytes[id] = size;
+
+   if(size > 0){
+
+      void *map = mmap(NULL,size,PROT_READ | PROT_WRITE,MAP_SHARED,fd,offset[id]);
+
+      if(map == MAP_FAILED)
+         throw std::runtime_error("MPOStore::write: mmap failed");
+
+      char *ptr = static_cast<char *>(map);
+
+      for(int col = 0;col < layer.size();++col){
+
+         memcpy(ptr,layer[col].data(),layer[col].size() * sizeof(double));
+         ptr += layer[col].size() * sizeof(double);
+
+         layer[col].clear();
+
+      }
+
+      //pages go to the page cache, not to the resident set
+      munmap(map,size);
+
+   }
+
+   on_disk[id] = true;
+   in_memory[id] = false;
+
+   lru.remove(id);
+
+}
+
+/**
+ * read a stored layer back from the scratch file, pending scaling factors are applied
+ * @param id layer index
+ * @param layer output: the layer, tensors are resized
+ */
+void MPOStore::read(int id,MPO<double> &layer){
+
+   if(!on_disk[id])
+      return;
+
+   if(bytes[id] > 0){
+
+      void *map = mmap(NULL,bytes[id],PROT_READ,MAP_SHARED,fd,offset[id]);
+
+      if(map == MAP_FAILED)
+         throw std::runtime_error("MPOStore::read: mmap failed");
+
+      madvise(map,bytes[id],MADV_SEQUENTIAL);
+
+      const char *ptr = static_cast<const char *>(map);
+
+      for(int col = 0;col < layer.size();++col){
+
+         layer[col].resize(shapes[id][col]);
+
+         memcpy(layer[col].data(),ptr,layer[col].size() * sizeof(double));
+         ptr += layer[col].size() * sizeof(double);
+
+      }
+
+      munmap(map,bytes[id]);
+
+   }
+
+   if(factor[id] != 1.0){
+
+      layer.scal(factor[id]);
+      factor[id] = 1.0;
+
+   }
+
+}
+
+/**
+ * ask the kernel to start reading a stored layer, so that the next read does not have to wait for the disk
+ * @param id layer index
+ */
+void MPOStore::prefetch(int id) const {
+
+   if(this->stored(id) && bytes[id] > 0)
+      posix_fadvise(fd,offset[id],bytes[id],POSIX_FADV_WILLNEED);
+
+}
+
+/**
+ * scale a stored layer: the factor is applied when the layer is read
+ * @param id layer index
+ * @param alpha scaling factor
+ */
+void MPOStore::scal(int id,double alpha){
+
+   factor[id] *= alpha;
+
+}
@@ -112,7 +112,8 @@ int MPS<T>::gd_phys() const {
 
 
 /**
- * act with an MPO on this MPS, resulting MPS is returned as *this object
+ * act with an MPO on this MPS, resulting MPS is returned as *this object. This is exact: the bond dimension becomes D*DO,
+ * see the other gemv for a compressed application
  * @param uplo if == 'U' contract with the upper physical index of the MPO, if == 'L', contract with the lower
  * @param mpo the MPO
  */
@@ -199,6 +200,234 @@ void MPS<T>::gemv(char uplo,const MPO<T> &mpo){
 
 }
 
+/**
+ * act with an MPO on this MPS and compress the result to bond dimension D_max on the fly (zip-up): the MPS is first right canonicalized,
+ * then every site is contracted with the MPO and with the remainder of the previous site, and split with an svd truncated to D_max.
+ * The remainder (D_max,D,DO) is carried to the next site, so the D*DO chain is never formed. The zip-up truncates against a part on the right
+ * which is no longer orthonormal, so a sweep of svd's from right to left follows, which truncates the left canonical result properly.
+ * This can be refined with variational sweeps, which fit it to the exact product one site at a time. On exit the MPS is right canonical,
+ * with the norm on the first site.
+ * @param uplo if == 'U' contract with the upper physical index of the MPO, if == 'L', contract with the lower
+ * @param mpo the MPO
+ * @param D_max bond dimension of the result
+ * @param n_sweeps nr of variational sweeps (left to right and back) after the compression, 0 for none. The default of two converges the fit,
+ * which Measurement::transfer relies on for the long range correlations
+ */
+template<typename T>
+void MPS<T>::gemv(char uplo,const MPO<T> &mpo,int D_max,int n_sweeps){
+
+   int L = this->size();
+
+   //operators with the index which is contracted with the MPS in second place: (left,in,out,right)
+   vector< TArray<T,4> > W(L);
+
+   for(int c = 0;c < L;++c){
+
+      if(uplo == 'U')
+         W[c] = mpo[c];
+      else
+         Permute(mpo[c],shape(0,2,1,3),W[c]);
+
+   }
+
+   //truncations are better when the part on the right is orthonormal
+   this->canonicalize(Right,false);
+
+   //the input is needed for the variational sweeps
+   MPS<T> ket;
+
+   if(n_sweeps > 0)
+      ket = *this;
+
+   //remainder: (new bond,MPS bond,MPO bond)
+   TArray<T,3> C(1,1,1);
+   C = (T)1.0;
+
+   for(int c = 0;c < L;++c){
+
+      TArray<T,4> tmp4;
+      Contract((T)1.0,C,shape(1),(*this)[c],shape(0),(T)0.0,tmp4);
+
+      TArray<T,4> tmp4bis;
+      Contract((T)1.0,tmp4,shape(1,2),W[c],shape(0,1),(T)0.0,tmp4bis);
+
+      //(new bond,out,MPS bond,MPO bond)
+      tmp4.clear();
+      Permute(tmp4bis,shape(0,2,1,3),tmp4);
+
+      if(c < L - 1){
+
+         TArray<typename remove_complex<T>::type,1> S;
+         TArray<T,3> U;
+
+         C.clear();
+         Gesvd('S','S',tmp4,S,U,C,D_max);
+
+         Dimm(S,C);
+
+         (*this)[c] = std::move(U);
+
+      }
+      else
+         (*this)[c] = tmp4.reshape_clear(shape(tmp4.shape(0),tmp4.shape(1),1));
+
+   }
+
+   //the bonds cannot exceed the dimension of the part on their right either
+   vector<int> vdim(L + 1);
+
+   vdim[L] = 1;
+
+   for(int c = L - 1;c > 0;--c)
+      vdim[c] = std::min(D_max,vdim[c + 1] * W[c].shape(2));
+
+   D = 1;
+
+   for(int c = L - 1;c > 0;--c){
+
+      TArray<typename remove_complex<T>::type,1> S;
+      TArray<T,2> U;
+      TArray<T,3> VT;
+
+      Gesvd('S','S',(*this)[c],S,U,VT,vdim[c]);
+
+      Dimm(U,S);
+
+      (*this)[c] = std::move(VT);
+
+      TArray<T,3> tmp;
+      Contract((T)1.0,(*this)[c - 1],shape(2),U,shape(0),(T)0.0,tmp);
+
+      (*this)[c - 1] = std::move(tmp);
+
+      D = std::max(D,(*this)[c].shape(0));
+
+   }
+
+   d_phys = (*this)[0].shape(1);
+
+   if(n_sweeps > 0)
+      this->fit(ket,W,n_sweeps);
+
+}
+
+/**
+ * variational sweeps which fit this MPS to the product of operators W with ket, one site at a time: every site is replaced by the
+ * overlap of the product with the rest of this MPS, which is optimal when the rest is orthonormal. The MPS has to be right canonical on entry,
+ * a sweep goes from left to right and back, and leaves it right canonical.
+ * @param ket the MPS the operators act on
+ * @param W the operators, with the index contracted with ket in second place
+ * @param n_sweeps nr of sweeps
+ */
+template<typename T>
+void MPS<T>::fit(const MPS<T> &ket,const vector< TArray<T,4> > &W,int n_sweeps){
+
+   int L = this->size();
+
+   //left and right overlaps: (bond of this,bond of ket,MPO bond), LO[c] on the left of site c, RO[c] on the right
+   vector< TArray<T,3> > LO(L);
+   vector< TArray<T,3> > RO(L);
+
+   LO[0].resize(1,1,1);
+   LO[0] = (T)1.0;
+
+   RO[L - 1].resize(1,1,1);
+   RO[L - 1] = (T)1.0;
+
+   //the product of the operator with ket on site c, closed by LO[c]: (bond of this,bond of ket,out,MPO bond)
+   TArray<T,4> prod;
+
+   TArray<T,4> tmp4;
+   TArray<T,4> tmp4bis;
+   TArray<T,3> tmp3;
+
+   for(int c = L - 1;c > 0;--c){
+
+      tmp4.clear();
+      Contract((T)1.0,ket[c],shape(2),RO[c],shape(1),(T)0.0,tmp4);
+
+      tmp4bis.clear();
+      Contract((T)1.0,tmp4,shape(1,3),W[c],shape(1,3),(T)0.0,tmp4bis);
+
+      TArray<T,3> bra((*this)[c]);
+      Conj(bra);
+
+      tmp3.clear();
+      Contract((T)1.0,tmp4bis,shape(1,3),bra,shape(2,1),(T)0.0,tmp3);
+
+      RO[c - 1].clear();
+      Permute(tmp3,shape(2,0,1),RO[c - 1]);
+
+   }
+
+   for(int sweep = 0;sweep < n_sweeps;++sweep){
+
+      //left to right: the optimal site, QR, and the left overlap of the orthonormal site
+      for(int c = 0;c < L - 1;++c){
+
+         tmp4.clear();
+         Contract((T)1.0,LO[c],shape(1),ket[c],shape(0),(T)0.0,tmp4);
+
+         prod.clear();
+         Contract((T)1.0,tmp4,shape(1,2),W[c],shape(0,1),(T)0.0,prod);
+
+         (*this)[c].clear();
+         Contract((T)1.0,prod,shape(1,3),RO[c],shape(1,2),(T)0.0,(*this)[c]);
+
+         TArray<T,2> R;
+         Geqrf((*this)[c],R);
+
+         TArray<T,3> bra((*this)[c]);
+         Conj(bra);
+
+         tmp3.clear();
+         Contract((T)1.0,prod,shape(0,2),bra,shape(0,1),(T)0.0,tmp3);
+
+         LO[c + 1].clear();
+         Permute(tmp3,shape(2,0,1),LO[c + 1]);
+
+      }
+
+      //right to left: the optimal site, LQ, and the right overlap of the orthonormal site
+      for(int c = L - 1;c >= 0;--c){
+
+         tmp4.clear();
+         Contract((T)1.0,LO[c],shape(1),ket[c],shape(0),(T)0.0,tmp4);
+
+         prod.clear();
+         Contract((T)1.0,tmp4,shape(1,2),W[c],shape(0,1),(T)0.0,prod);
+
+         (*this)[c].clear();
+         Contract((T)1.0,prod,shape(1,3),RO[c],shape(1,2),(T)0.0,(*this)[c]);
+
+         //the first site keeps the norm
+         if(c == 0)
+            break;
+
+         TArray<T,2> Lq;
+         Gelqf(Lq,(*this)[c]);
+
+         tmp4.clear();
+         Contract((T)1.0,ket[c],shape(2),RO[c],shape(1),(T)0.0,tmp4);
+
+         tmp4bis.clear();
+         Contract((T)1.0,tmp4,shape(1,3),W[c],shape(1,3),(T)0.0,tmp4bis);
+
+         TArray<T,3> bra((*this)[c]);
+         Conj(bra);
+
+         tmp3.clear();
+         Contract((T)1.0,tmp4bis,shape(1,3),bra,shape(2,1),(T)0.0,tmp3);
+
+         RO[c - 1].clear();
+         Permute(tmp3,shape(2,0,1),RO[c - 1]);
+
+      }
+
+   }
+
+}
+
 /**
  * canonicalize the mps
  * @param dir Left or Right canonicalization
@@ -374,6 +603,9 @@ template int MPS< complex<double> >::gD() const;
 template void MPS<double>::gemv(char uplo,const MPO<double> &mpo);
 template void MPS< complex<double> >::gemv(char uplo,const MPO< complex<double> > &mpo);
 
+template void MPS<double>::gemv(char uplo,const MPO<double> &mpo,int,int);
+template void MPS< complex<double> >::gemv(char uplo,const MPO< complex<double> > &mpo,int,int);
+
 template void MPS<double>::canonicalize(const BTAS_SIDE &dir,bool);
 template void MPS< complex<double> >::canonicalize(const BTAS_SIDE &dir,bool);
 
@@ -0,0 +1,991 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <map>
+#include <tuple>
+#include <stdexcept>
+
+using std::cout;
+using std::endl;
+using std::ostream;
+using std::vector;
+
+#include "include.h"
+
+using namespace btas;
+using namespace global;
+
+/**
+ * empty constructor: no operators and no terms
+ */
+Measurement::Measurement(){
+
+   for(int i = 0;i < 3;++i)
+      spin[i] = -1;
+
+}
+
+/**
+ * copy constructor
+ * @param meas_copy object to copy
+ */
+Measurement::Measurement(const Measurement &meas_copy){
+
+   ops = meas_copy.ops;
+
+   names = meas_copy.names;
+   values = meas_copy.values;
+   norms = meas_copy.norms;
+
+   products = meas_copy.products;
+
+   for(int i = 0;i < 3;++i)
+      spin[i] = meas_copy.spin[i];
+
+   h_bond = meas_copy.h_bond;
+   v_bond = meas_copy.v_bond;
+
+   corr = meas_copy.corr;
+
+}
+
+/**
+ * empty destructor
+ */
+Measurement::~Measurement(){ }
+
+/**
+ * register a one-site operator
+ * @param O the operator (phys_out,phys_in)
+ * @return the id of the operator
+ */
+int Measurement::add_operator(const DArray<2> &O){
+
+   ops.push_back(O);
+
+   return ops.size() - 1;
+
+}
+
+/**
+ * start a new observable, products are added to it with add and add_string
+ * @param name name of the observable, used in the output
+ * @return the id of the term
+ */
+int Measurement::term(const std::string &name){
+
+   names.push_back(name);
+   values.push_back(0.0);
+   norms.push_back(1.0);
+
+   return names.size() - 1;
+
+}
+
+/**
+ * add a one-site product to a term
+ * @param t id of the term
+ * @param coef coefficient of the product
+ * @param op id of the operator
+ * @param row row index of the site
+ * @param col column index of the site
+ */
+void Measurement::add(int t,double coef,int op,int row,int col){
+
+   Product p;
+
+   p.term = t;
+   p.coef = coef;
+
+   p.rowA = row;
+   p.colA = col;
+   p.opA = op;
+
+   p.rowB = row;
+   p.colB = col;
+   p.opB = -1;
+
+   p.opS = -1;
+
+   products.push_back(p);
+
+}
+
+/**
+ * add a two-site product to a term. If both sites are the same, the operator is the matrix product opA opB. Sites which lie more than
+ * one row apart are evaluated with transferred boundary layers, see measure_long.
+ * @param t id of the term
+ * @param coef coefficient of the product
+ * @param opA id of the operator on the first site
+ * @param rowA row index of the first site
+ * @param colA column index of the first site
+ * @param opB id of the operator on the second site
+ * @param rowB row index of the second site
+ * @param colB column index of the second site
+ */
+void Measurement::add(int t,double coef,int opA,int rowA,int colA,int opB,int rowB,int colB){
+
+   Product p;
+
+   p.term = t;
+   p.coef = coef;
+
+   //the left site goes first
+   if(colB < colA){
+
+      std::swap(opA,opB);
+      std::swap(rowA,rowB);
+      std::swap(colA,colB);
+
+   }
+
+   p.rowA = rowA;
+   p.colA = colA;
+   p.opA = opA;
+
+   p.rowB = rowB;
+   p.colB = colB;
+   p.opB = opB;
+
+   p.opS = -1;
+
+   products.push_back(p);
+
+}
+
+/**
+ * add a string product on a row to a term: opA on (row,colA), opS on every site in between and opB on (row,colB)
+ * @param t id of the term
+ * @param coef coefficient of the product
+ * @param row the row
+ * @param opA id of the operator on the left end of the string
+ * @param colA column of the left end
+ * @param opS id of the string operator
+ * @param opB id of the operator on the right end of the string
+ * @param colB column of the right end
+ */
+void Measurement::add_string(int t,double coef,int row,int opA,int colA,int opS,int opB,int colB){
+
+   if(colB <= colA)
+      throw std::runtime_error("Measurement::add_string: the left end of the string has to lie left of the right end");
+
+   this->add(t,coef,opA,row,colA,opB,row,colB);
+
+   products.back().opS = opS;
+
+}
+
+/**
+ * register Sx, iSy and Sz, the spin-1/2 operators of the Hamiltonian
+ */
+void Measurement::spin_operators(){
+
+   if(spin[0] != -1)
+      return;
+
+   if(global::d != 2)
+      throw std::runtime_error("Measurement::spin_operators: spin correlations are only implemented for d = 2");
+
+   DArray<2> S(2,2);
+
+   //Sx
+   S = 0.0;
+   S(0,1) = 0.5;
+   S(1,0) = 0.5;
+
+   spin[0] = this->add_operator(S);
+
+   //iSy
+   S = 0.0;
+   S(0,1) = -0.5;
+   S(1,0) = 0.5;
+
+   spin[1] = this->add_operator(S);
+
+   //Sz
+   S = 0.0;
+   S(0,0) = -0.5;
+   S(1,1) = 0.5;
+
+   spin[2] = this->add_operator(S);
+
+}
+
+/**
+ * add the spin correlation <S_A . S_B> between two sites as a new term. As in Hamiltonian, the state lives in the basis rotated by the
+ * Marshall sign rule, so the x and y parts change sign between sites on different sublattices.
+ * @param rowA row index of the first site
+ * @param colA column index of the first site
+ * @param rowB row index of the second site
+ * @param colB column index of the second site
+ * @return the id of the term
+ */
+int Measurement::spin_correlation(int rowA,int colA,int rowB,int colB){
+
+   this->spin_operators();
+
+   std::ostringstream name;
+   name << "SS(" << rowA << "," << colA << ";" << rowB << "," << colB << ")";
+
+   int t = this->term(name.str());
+
+   //Sx Sx - iSy iSy + Sz Sz, or the Marshall rotated version
+   double coef[3];
+
+   if( (rowA + colA + rowB + colB) % 2 == 1 ){
+
+      coef[0] = -1.0;
+      coef[1] = 1.0;
+
+   }
+   else{
+
+      coef[0] = 1.0;
+      coef[1] = -1.0;
+
+   }
+
+   coef[2] = 1.0;
+
+   for(int i = 0;i < 3;++i)
+      this->add(t,coef[i],spin[i],rowA,colA,spin[i],rowB,colB);
+
+   return t;
+
+}
+
+/**
+ * add the spin correlations between site (row,col) and every other site of the lattice
+ * @param row row index of the reference site
+ * @param col column index of the reference site
+ */
+void Measurement::correlation_map(int row,int col){
+
+   for(int r = 0;r < Ly;++r)
+      for(int c = 0;c < Lx;++c)
+         if(r != row || c != col)
+            this->spin_correlation(row,col,r,c);
+
+}
+
+/**
+ * add the spin correlations of all pairs of sites, used by structure_factor
+ */
+void Measurement::correlations(){
+
+   int N = Lx * Ly;
+
+   corr.assign(N,vector<int>(N,-1));
+
+   for(int s1 = 0;s1 < N;++s1)
+      for(int s2 = s1 + 1;s2 < N;++s2){
+
+         corr[s1][s2] = this->spin_correlation(s1 / Lx,s1 % Lx,s2 / Lx,s2 % Lx);
+         corr[s2][s1] = corr[s1][s2];
+
+      }
+
+}
+
+/**
+ * add the spin correlations on all nearest neighbour bonds, from which the dimer order parameters are obtained with gdimer
+ */
+void Measurement::dimers(){
+
+   h_bond.clear();
+   v_bond.clear();
+
+   for(int row = 0;row < Ly;++row)
+      for(int col = 0;col < Lx - 1;++col)
+         h_bond.push_back(this->spin_correlation(row,col,row,col + 1));
+
+   for(int row = 0;row < Ly - 1;++row)
+      for(int col = 0;col < Lx;++col)
+         v_bond.push_back(this->spin_correlation(row,col,row + 1,col));
+
+}
+
+/**
+ * the boundary layers which close the strip of the row pair (row,row+1): a trivial layer of ones on the edges of the lattice
+ * @param row lower row of the pair
+ * @param top output: layer above row + 1
+ * @param bottom output: layer below row
+ */
+void Measurement::layers(int row,MPO<double> &top,MPO<double> &bottom) const {
+
+   MPO<double> trivial(Lx);
+
+   for(int col = 0;col < Lx;++col){
+
+      trivial[col].resize(1,1,1,1);
+      trivial[col] = 1.0;
+
+   }
+
+   //copies, which stay valid if the environment moves a layer out-of-core
+   if(row < Ly - 2)
+      top = env.gt(row);
+   else
+      top = trivial;
+
+   if(row > 0)
+      bottom = env.gb(row - 1);
+   else
+      bottom = trivial;
+
+}
+
+/**
+ * add a column of the strip to a left renormalized operator, operators are applied to the second copy of the peps tensors
+ * @param LO input left renormalized operator (top,upper,upper,lower,lower,bottom)
+ * @param row lower row of the pair
+ * @param col the column
+ * @param top layer above the strip
+ * @param bottom layer below the strip
+ * @param peps the PEPS<double>
+ * @param O_u operator on the upper site, 0 if none
+ * @param O_d operator on the lower site, 0 if none
+ * @param out output: the left renormalized operator to the right of col
+ */
+void Measurement::step(const DArray<6> &LO,int row,int col,const MPO<double> &top,const MPO<double> &bottom,const PEPS<double> &peps,
+      const DArray<2> *O_u,const DArray<2> *O_d,DArray<6> &out) const {
+
+   enum {j,k,l,m,n,o};
+
+   DArray<5> peps_op;
+
+   DArray<8> tmp8;
+   Contract(1.0,LO,shape(0),top[col],shape(0),0.0,tmp8);
+
+   //upper site
+   DArray<9> tmp9;
+   Contract(1.0,tmp8,shape(0,5),peps(row+1,col),shape(0,1),0.0,tmp9);
+
+   tmp8.clear();
+
+   if(O_u){
+
+      Contract(1.0,*O_u,shape(j,k),peps(row+1,col),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      Contract(1.0,tmp9,shape(0,4,6),peps_op,shape(0,1,2),0.0,tmp8);
+
+   }
+   else
+      Contract(1.0,tmp9,shape(0,4,6),peps(row+1,col),shape(0,1,2),0.0,tmp8);
+
+   //lower site
+   tmp9.clear();
+   Contract(1.0,tmp8,shape(0,4),peps(row,col),shape(0,1),0.0,tmp9);
+
+   tmp8.clear();
+
+   if(O_d){
+
+      peps_op.clear();
+      Contract(1.0,*O_d,shape(j,k),peps(row,col),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      Contract(1.0,tmp9,shape(0,4,6),peps_op,shape(0,1,2),0.0,tmp8);
+
+   }
+   else
+      Contract(1.0,tmp9,shape(0,4,6),peps(row,col),shape(0,1,2),0.0,tmp8);
+
+   //close with the bottom layer
+   out.clear();
+   Contract(1.0,tmp8,shape(0,4,6),bottom[col],shape(0,1,2),0.0,out);
+
+}
+
+/**
+ * add a column of the strip to a right renormalized operator
+ * @param RO input right renormalized operator to the right of col, legs as the left ones: (top,upper,upper,lower,lower,bottom)
+ * @param row lower row of the pair
+ * @param col the column
+ * @param top layer above the strip
+ * @param bottom layer below the strip
+ * @param peps the PEPS<double>
+ * @param out output: the right renormalized operator to the right of col - 1
+ */
+void Measurement::step_right(const DArray<6> &RO,int row,int col,const MPO<double> &top,const MPO<double> &bottom,const PEPS<double> &peps,
+      DArray<6> &out) const {
+
+   DArray<8> tmp8;
+   Contract(1.0,top[col],shape(3),RO,shape(0),0.0,tmp8);
+
+   //upper site
+   DArray<9> tmp9;
+   Contract(1.0,tmp8,shape(1,3),peps(row+1,col),shape(1,4),0.0,tmp9);
+
+   tmp8.clear();
+   Contract(1.0,tmp9,shape(1,2,7),peps(row+1,col),shape(1,4,2),0.0,tmp8);
+
+   //lower site
+   tmp9.clear();
+   Contract(1.0,tmp8,shape(5,1),peps(row,col),shape(1,4),0.0,tmp9);
+
+   tmp8.clear();
+   Contract(1.0,tmp9,shape(5,1,7),peps(row,col),shape(1,4,2),0.0,tmp8);
+
+   //close with the bottom layer
+   out.clear();
+   Contract(1.0,tmp8,shape(1,5,7),bottom[col],shape(3,1,2),0.0,out);
+
+}
+
+/**
+ * evaluate the products on the row pair (row,row+1) in a single sweep of its strip
+ * @param row lower row of the pair
+ * @param top layer above the strip
+ * @param bottom layer below the strip
+ * @param peps the PEPS<double>
+ * @param list the products which lie on this row pair
+ * @param val output: the expectation values of the products in the list, divided by the norm if normalize is true
+ * @param normalize if false the values are left undivided, for strips whose own norm can vanish
+ * @return the norm of the state seen by the strip
+ */
+double Measurement::measure_pair(int row,const MPO<double> &top,const MPO<double> &bottom,const PEPS<double> &peps,const vector<Product> &list,
+      vector<double> &val,bool normalize) const {
+
+   val.resize(list.size());
+
+   //right renormalized operators: RO[col] contains the columns col + 1 ... Lx - 1
+   vector< DArray<6> > RO(Lx);
+
+   RO[Lx - 1].resize(1,1,1,1,1,1);
+   RO[Lx - 1] = 1.0;
+
+   for(int col = Lx - 1;col > 0;--col)
+      this->step_right(RO[col],row,col,top,bottom,peps,RO[col - 1]);
+
+   //left renormalized operators: LO[col] contains the columns 0 ... col - 1
+   vector< DArray<6> > LO(Lx);
+
+   LO[0].resize(1,1,1,1,1,1);
+   LO[0] = 1.0;
+
+   for(int col = 0;col < Lx - 1;++col)
+      this->step(LO[col],row,col,top,bottom,peps,0,0,LO[col + 1]);
+
+   DArray<6> tmp6;
+   this->step(LO[0],row,0,top,bottom,peps,0,0,tmp6);
+
+   double norm = Dot(tmp6,RO[0]);
+
+   double scale = normalize ? norm : 1.0;
+
+   //products which share the left operator with the first operator applied: same site, same operator and same string
+   std::map< std::tuple<int,int,int,int>,vector<int> > open;
+
+   for(int i = 0;i < list.size();++i){
+
+      const Product &p = list[i];
+
+      //products within a single column are closed right away
+      if(p.opB == -1 || p.colA == p.colB){
+
+         DArray<2> O_AB;
+
+         const DArray<2> *O_u = 0;
+         const DArray<2> *O_d = 0;
+
+         if(p.opB == -1)
+            (p.rowA == row ? O_d : O_u) = &ops[p.opA];
+         else if(p.rowA == p.rowB){
+
+            Gemm(CblasNoTrans,CblasNoTrans,1.0,ops[p.opA],ops[p.opB],0.0,O_AB);
+            (p.rowA == row ? O_d : O_u) = &O_AB;
+
+         }
+         else{
+
+            (p.rowA == row ? O_d : O_u) = &ops[p.opA];
+            (p.rowB == row ? O_d : O_u) = &ops[p.opB];
+
+         }
+
+         tmp6.clear();
+         this->step(LO[p.colA],row,p.colA,top,bottom,peps,O_u,O_d,tmp6);
+
+         val[i] = Dot(tmp6,RO[p.colA]) / scale;
+
+      }
+      else
+         open[std::make_tuple(p.colA,p.rowA,p.opA,p.opS)].push_back(i);
+
+   }
+
+   DArray<6> L_op;
+
+   for(auto it = open.begin();it != open.end();++it){
+
+      int colA = std::get<0>(it->first);
+      int rowA = std::get<1>(it->first);
+      int opA = std::get<2>(it->first);
+      int opS = std::get<3>(it->first);
+
+      const vector<int> &group = it->second;
+
+      int last = colA;
+
+      for(int i = 0;i < group.size();++i)
+         last = std::max(last,list[group[i]].colB);
+
+      //open the left operator
+      L_op.clear();
+
+      if(rowA == row)
+         this->step(LO[colA],row,colA,top,bottom,peps,0,&ops[opA],L_op);
+      else
+         this->step(LO[colA],row,colA,top,bottom,peps,&ops[opA],0,L_op);
+
+      //and move it to the right, closing the products on the way
+      for(int col = colA + 1;col <= last;++col){
+
+         for(int i = 0;i < group.size();++i){
+
+            const Product &p = list[group[i]];
+
+            if(p.colB != col)
+               continue;
+
+            tmp6.clear();
+
+            if(p.rowB == row)
+               this->step(L_op,row,col,top,bottom,peps,0,&ops[p.opB],tmp6);
+            else
+               this->step(L_op,row,col,top,bottom,peps,&ops[p.opB],0,tmp6);
+
+            val[group[i]] = Dot(tmp6,RO[col]) / scale;
+
+         }
+
+         if(col < last){
+
+            const DArray<2> *O_S = (opS == -1) ? 0 : &ops[opS];
+
+            tmp6.clear();
+
+            if(rowA == row)
+               this->step(L_op,row,col,top,bottom,peps,0,O_S,tmp6);
+            else
+               this->step(L_op,row,col,top,bottom,peps,O_S,0,tmp6);
+
+            L_op = std::move(tmp6);
+
+         }
+
+      }
+
+   }
+
+   return norm;
+
+}
+
+/**
+ * add the double layer of a peps row to a boundary layer from below. The result is compressed to the auxiliary dimension of the
+ * environment with MPS::gemv, the double layer acting as an MPO with the two copies of every virtual index merged, which costs
+ * D_aux^2 D^8 per site.
+ * @param row the row
+ * @param peps the PEPS<double>
+ * @param col column of the operator, -1 if none
+ * @param O operator on (row,col), applied to the second copy of the peps tensor, 0 if none
+ * @param layer input: the layer below row as an MPS (left,upper ket x upper bra,right), output: the layer above row
+ */
+void Measurement::transfer(int row,const PEPS<double> &peps,int col,const DArray<2> *O,MPS<double> &layer) const {
+
+   enum {i,j,k,l,m,n,o,p,q};
+
+   MPO<double> W(Lx);
+
+   DArray<5> peps_op;
+   DArray<8> tmp8;
+
+   for(int c = 0;c < Lx;++c){
+
+      const DArray<5> &A = peps(row,c);
+
+      const DArray<5> *B = &A;
+
+      if(O && c == col){
+
+         peps_op.clear();
+         Contract(1.0,*O,shape(j,k),A,shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+
+         B = &peps_op;
+
+      }
+
+      //(left,left,down,down,up,up,right,right)
+      tmp8.clear();
+      Contract(1.0,A,shape(i,j,k,l,m),*B,shape(n,o,k,p,q),0.0,tmp8,shape(i,n,l,p,j,o,m,q));
+
+      W[c] = tmp8.reshape_clear(shape(A.shape(0) * A.shape(0),A.shape(3) * A.shape(3),A.shape(1) * A.shape(1),A.shape(4) * A.shape(4)));
+
+   }
+
+   layer.gemv('U',W,env.gD_aux());
+
+}
+
+/**
+ * evaluate the products whose sites lie more than one row apart, with the lower site on row 'row'. The layer below row is moved up
+ * with transfer, once with the operator of the lower site in it for every (site,operator) pair, and once without as a reference. A product is
+ * closed on the strip of the row pair below its upper site, between the transferred layer and the top layer of the environment, and divided
+ * by the norm of that strip with the reference layer, so that the truncations of the transfers largely cancel.
+ * @param row row of the lower sites
+ * @param peps the PEPS<double>
+ * @param list indices of the products
+ * @param val output: the expectation values of the products, at their indices
+ * @param norm output: the norms by which they were divided, at their indices
+ */
+void Measurement::measure_long(int row,const PEPS<double> &peps,const vector<int> &list,vector<double> &val,vector<double> &norm) const {
+
+   //the lower site goes first
+   vector<Product> prod(list.size());
+
+   for(int i = 0;i < list.size();++i){
+
+      prod[i] = products[list[i]];
+
+      if(prod[i].rowB < prod[i].rowA){
+
+         std::swap(prod[i].rowA,prod[i].rowB);
+         std::swap(prod[i].colA,prod[i].colB);
+         std::swap(prod[i].opA,prod[i].opB);
+
+      }
+
+   }
+
+   //products with the same operator on the same lower site share the transferred layer
+   std::map< std::pair<int,int>,vector<int> > groups;
+
+   for(int i = 0;i < prod.size();++i)
+      groups[std::make_pair(prod[i].colA,prod[i].opA)].push_back(i);
+
+   //the layer below row, as an MPS
+   MPS<double> ref(Lx);
+
+   if(row == 0){
+
+      for(int col = 0;col < Lx;++col){
+
+         ref[col].resize(1,1,1);
+         ref[col] = 1.0;
+
+      }
+
+   }
+   else{
+
+      const MPO<double> &bottom = env.gb(row - 1);
+
+      for(int col = 0;col < Lx;++col)
+         ref[col] = bottom[col].reshape(shape(bottom[col].shape(0),bottom[col].shape(1) * bottom[col].shape(2),bottom[col].shape(3)));
+
+   }
+
+   int last = row;
+
+   vector< MPS<double> > layer(groups.size(),ref);
+   vector<int> group_last(groups.size(),row);
+
+   int g = 0;
+
+   for(auto it = groups.begin();it != groups.end();++it,++g)
+      for(int i = 0;i < it->second.size();++i){
+
+         group_last[g] = std::max(group_last[g],prod[it->second[i]].rowB);
+         last = std::max(last,group_last[g]);
+
+      }
+
+   MPO<double> top;
+   MPO<double> bottom(Lx);
+
+   vector<double> v;
+
+   for(int r = row;r <= last - 2;++r){
+
+      this->transfer(r,peps,-1,0,ref);
+
+      //reference norm of the strip (r+1,r+2)
+      this->layers(r + 1,top,bottom);
+
+      for(int col = 0;col < Lx;++col){
+
+         int D_u = peps(r,col).shape(1);
+         bottom[col] = ref[col].reshape(shape(ref[col].shape(0),D_u,D_u,ref[col].shape(2)));
+
+      }
+
+      double nrm = this->measure_pair(r + 1,top,bottom,peps,vector<Product>(),v);
+
+      g = 0;
+
+      for(auto it = groups.begin();it != groups.end();++it,++g){
+
+         if(r > group_last[g] - 2)
+            continue;
+
+         if(r == row)
+            this->transfer(r,peps,it->first.first,&ops[it->first.second],layer[g]);
+         else
+            this->transfer(r,peps,-1,0,layer[g]);
+
+         //the products with the upper site on row r + 2 become one-site products on the strip
+         vector<Product> close;
+         vector<int> index;
+
+         for(int i = 0;i < it->second.size();++i){
+
+            Product p = prod[it->second[i]];
+
+            if(p.rowB != r + 2)
+               continue;
+
+            p.rowA = p.rowB;
+            p.colA = p.colB;
+            p.opA = p.opB;
+            p.opB = -1;
+
+            close.push_back(p);
+            index.push_back(list[it->second[i]]);
+
+         }
+
+         if(close.empty())
+            continue;
+
+         for(int col = 0;col < Lx;++col){
+
+            int D_u = peps(r,col).shape(1);
+            bottom[col] = layer[g][col].reshape(shape(layer[g][col].shape(0),D_u,D_u,layer[g][col].shape(2)));
+
+         }
+
+         //the strip with only the lower operator in it closes to <O_A>, which vanishes by symmetry for a single spin operator
+         this->measure_pair(r + 1,top,bottom,peps,close,v,false);
+
+         for(int i = 0;i < close.size();++i){
+
+            val[index[i]] = v[i] / nrm;
+            norm[index[i]] = nrm;
+
+         }
+
+      }
+
+   }
+
+}
+
+/**
+ * evaluate all terms on a state: the environment is calculated once, after which the row pairs are swept independently of each other
+ * @param peps the PEPS<double>
+ */
+void Measurement::measure(PEPS<double> &peps){
+
+   env.calc('A',peps);
+
+   //assign every product to a row pair: the pair of its lowest row, the top pair for products on the top row. Products whose sites lie
+   //more than one row apart go to the row of their lower site
+   vector< vector<int> > pair(Ly - 1);
+   vector< vector<int> > lower(Ly);
+
+   for(int i = 0;i < products.size();++i){
+
+      int row = std::min(products[i].rowA,products[i].rowB);
+
+      if(std::abs(products[i].rowA - products[i].rowB) > 1)
+         lower[row].push_back(i);
+      else{
+
+         if(row == Ly - 1)
+            row = Ly - 2;
+
+         pair[row].push_back(i);
+
+      }
+
+   }
+
+   vector<double> val(products.size());
+   vector<double> norm(products.size(),1.0);
+
+   //loading layers from the store is not thread safe
+#pragma omp parallel for schedule(dynamic) if(env.gstore().gcapacity() == 0)
+   for(int row = 0;row < Ly - 1;++row)
+      if(!pair[row].empty()){
+
+         MPO<double> top;
+         MPO<double> bottom;
+
+         this->layers(row,top,bottom);
+
+         vector<Product> list(pair[row].size());
+
+         for(int i = 0;i < list.size();++i)
+            list[i] = products[pair[row][i]];
+
+         vector<double> v;
+         double nrm = this->measure_pair(row,top,bottom,peps,list,v);
+
+         for(int i = 0;i < list.size();++i){
+
+            val[pair[row][i]] = v[i];
+            norm[pair[row][i]] = nrm;
+
+         }
+
+      }
+
+#pragma omp parallel for schedule(dynamic) if(env.gstore().gcapacity() == 0)
+   for(int row = 0;row < Ly - 2;++row)
+      if(!lower[row].empty())
+         this->measure_long(row,peps,lower[row],val,norm);
+
+   values.assign(names.size(),0.0);
+   norms.assign(names.size(),1.0);
+
+   for(int i = 0;i < products.size();++i){
+
+      values[products[i].term] += products[i].coef * val[i];
+      norms[products[i].term] = norm[i];
+
+   }
+
+}
+
+/**
+ * @return the nr of terms
+ */
+int Measurement::size() const {
+
+   return names.size();
+
+}
+
+/**
+ * @param t id of the term
+ * @return the expectation value of term t, after measure
+ */
+double Measurement::gvalue(int t) const {
+
+   return values[t];
+
+}
+
+/**
+ * @param t id of the term
+ * @return the name of term t
+ */
+const std::string &Measurement::gname(int t) const {
+
+   return names[t];
+
+}
+
+/**
+ * @param t id of the term
+ * @return the norm of the state on the row pair of term t, after measure: the values are divided by it
+ */
+double Measurement::gnorm(int t) const {
+
+   return norms[t];
+
+}
+
+/**
+ * dimer order parameter: the staggered average of the nearest neighbour spin correlations, requires dimers() before measure
+ * @param option 'h'orizontal bonds, staggered along the rows, or 'v'ertical bonds, staggered along the columns
+ * @return the dimer order parameter
+ */
+double Measurement::gdimer(const char option) const {
+
+   double val = 0.0;
+
+   if(option == 'h'){
+
+      if(h_bond.empty())
+         return 0.0;
+
+      for(int i = 0;i < h_bond.size();++i){
+
+         int col = i % (Lx - 1);
+
+         val += ( (col % 2 == 0) ? 1.0 : -1.0 ) * values[h_bond[i]];
+
+      }
+
+      return val / (double) h_bond.size();
+
+   }
+   else{
+
+      if(v_bond.empty())
+         return 0.0;
+
+      for(int i = 0;i < v_bond.size();++i){
+
+         int row = i / Lx;
+
+         val += ( (row % 2 == 0) ? 1.0 : -1.0 ) * values[v_bond[i]];
+
+      }
+
+      return val / (double) v_bond.size();
+
+   }
+
+}
+
+/**
+ * structure factor S(q) = 1/N sum_{i,j} exp(iq.(r_i - r_j)) <S_i . S_j>, requires correlations() before measure
+ * @param qx the wave vector along the rows
+ * @param qy the wave vector along the columns
+ * @return S(q)
+ */
+double Measurement::structure_factor(double qx,double qy) const {
+
+   if(corr.empty())
+      throw std::runtime_error("Measurement::structure_factor: correlations() has not been called");
+
+   int N = Lx * Ly;
+
+   double val = 0.0;
+
+   for(int s1 = 0;s1 < N;++s1)
+      for(int s2 = 0;s2 < N;++s2){
+
+         if(s1 == s2)
+            val += 0.75;
+         else
+            val += cos(qx * (s1 % Lx - s2 % Lx) + qy * (s1 / Lx - s2 / Lx)) * values[corr[s1][s2]];
+
+      }
+
+   return val / (double) N;
+
+}
+
+/**
+ * print the terms and their values, followed by the dimer order parameters if dimers() was called
+ * @param output the stream to write to
+ */
+void Measurement::print(ostream &output) const {
+
+   output.precision(15);
+
+   for(int t = 0;t < names.size();++t)
+      output << names[t] << "\t" << values[t] << endl;
+
+   if(!h_bond.empty())
+      output << "dimer_h\t" << this->gdimer('h') << endl << "dimer_v\t" << this->gdimer('v') << endl;
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -3,6 +3,8 @@
 #include <cmath>
 #include <vector>
 #include <complex>
+#include <cstring>
+#include <stdexcept>
 
 using std::cout;
 using std::endl;
@@ -14,11 +16,20 @@ using std::ofstream;
 
 using namespace global;
 
+//!source of the row versions, shared by all PEPS objects so that no two different rows ever carry the same stamp
+static unsigned long version_counter = 0;
+
 /**
  * construct an empty PEPS object, note: be sure to initialize the Lattice object before calling the constructor
  */
 template<typename T>
-PEPS<T>::PEPS() : vector< TArray<T,5> >(Lx * Ly) { }
+PEPS<T>::PEPS() : vector< TArray<T,5> >(Lx * Ly) { 
+
+   log_norm = 0.0;
+
+   this->touch();
+
+}
 
 /**
  * construct constructs a standard PEPS object, note: be sure to initialize the Lattice object before calling the constructor
@@ -28,6 +39,8 @@ template<typename T>
 PEPS<T>::PEPS(int D_in) : vector< TArray<T,5> >(Lx * Ly) {
 
    D = D_in;
+
+   log_norm = 0.0;
    
    //corners first
 
@@ -77,16 +90,41 @@ PEPS<T>::PEPS(int D_in) : vector< TArray<T,5> >(Lx * Ly) {
 
       }
 
+   this->touch();
+
 }
 
 /**
- * copy constructor
+ * copy constructor: the copy gets fresh row versions, the environment was constructed for the original and the two may diverge.
+ * Otherwise rescaling the copy would rescale layers which belong to the original, see Environment::scal_row
  */
 template<typename T>
 PEPS<T>::PEPS(const PEPS<T> &peps_copy) : vector< TArray<T,5> >(peps_copy) {
 
    D = peps_copy.gD();
 
+   log_norm = peps_copy.glog_norm();
+
+   this->touch();
+
+}
+
+/**
+ * assignment: like the copy constructor, the rows get fresh versions
+ */
+template<typename T>
+PEPS<T> &PEPS<T>::operator=(const PEPS<T> &peps_copy){
+
+   vector< TArray<T,5> >::operator=(peps_copy);
+
+   D = peps_copy.gD();
+
+   log_norm = peps_copy.glog_norm();
+
+   this->touch();
+
+   return *this;
+
 }
 
 /**
@@ -142,28 +180,39 @@ void PEPS<T>::sD(int D_in) {
 }
 
 /**
- * rescale all the tensors, set largest value to num
+ * @param row the row index...
  * @param num number to rescale to
+ * rescale all the tensors, set largest value on row 'row' to one
  */
 template<>
-void PEPS<double>::rescale_tensors(double num){
+void PEPS<double>::rescale_tensors(int row,double num){
 
-   for(int row = 0;row < Ly;++row)
-      for(int col = 0;col < Lx;++col)
-         (*this)(row,col).rescale(num);
+   //factor with which the double layer of the row is multiplied
+   double factor = 1.0;
+
+   for(int col = 0;col < Lx;++col){
+
+      double max = (*this)(row,col).rescale(num);
+      factor *= (num/max) * (num/max);
+
+      log_norm += log(max/num);
+
+   }
+
+   //keep the environment layers which contain this row consistent
+   env.scal_row(row,factor,*this);
 
 }
 
 /**
- * @param row the row index...
+ * rescale all the tensors, set largest value to num
  * @param num number to rescale to
- * rescale all the tensors, set largest value on row 'row' to one
  */
 template<>
-void PEPS<double>::rescale_tensors(int row,double num){
+void PEPS<double>::rescale_tensors(double num){
 
-   for(int col = 0;col < Lx;++col)
-      (*this)(row,col).rescale(num);
+   for(int row = 0;row < Ly;++row)
+      this->rescale_tensors(row,num);
 
 }
 
@@ -184,6 +233,8 @@ void PEPS<T>::fill_Random(){
 
       }
 
+   this->touch();
+
 }
 
 /**
@@ -285,6 +336,8 @@ void PEPS<double>::initialize_ising(int D_in,int option,double noise) {
 
       }
 
+   this->touch();
+
 }
 
 /**
@@ -416,6 +469,8 @@ void PEPS<double>::initialize_jastrow(double f) {
    (*this)[(Ly - 1)*Lx + Lx - 1](1,0,1,0,0) = f;
    (*this)[(Ly - 1)*Lx + Lx - 1](1,0,1,1,0) = f*f;
 
+   this->touch();
+
 }
 
 /**
@@ -591,6 +646,8 @@ void PEPS<double>::grow_bond_dimension(int D_in,double noise) {
 
    (*this)[(Ly - 1)*Lx + Lx - 1] = std::move(tmp);
 
+   this->touch();
+
 }
 
 /**
@@ -625,16 +682,11 @@ double PEPS<double>::dot(PEPS<double> &peps_i,bool init) const {
 
    if(!init){
 
-      //construct bottom environment until half
-      env.gb(0).fill('b',peps_i);
-
-      for(int i = 1;i <= b_stop;++i)
-         env.add_layer('b',i,peps_i);
-
-      env.gt(Ly - 3).fill('t',peps_i);
+      //construct bottom environment until half, only the layers which are out of date are recalculated
+      env.update('b',b_stop,peps_i);
 
-      for(int i = Ly - 4;i >= t_stop;--i)
-         env.add_layer('t',i,peps_i);
+      //and the top environment
+      env.update('t',t_stop,peps_i);
 
    }
 
@@ -650,6 +702,9 @@ template<>
 void PEPS<double>::normalize(bool init){
 
    double val = sqrt(this->dot(*this,init));
+
+   log_norm += log(val);
+
    val = pow(val,1.0/(double)this->size());
 
    //now initialize with random numbers
@@ -657,6 +712,10 @@ void PEPS<double>::normalize(bool init){
       for(int c = 0;c < Lx;++c)
          Scal(1.0/val,(*this)[ r*Lx + c ]);
 
+   //the environment stays valid, it is just rescaled
+   for(int r = 0;r < Ly;++r)
+      env.scal_row(r,pow(val,-2.0*Lx),*this);
+
 }
 
 /**
@@ -673,53 +732,218 @@ void PEPS<T>::scal(T val){
       for(int c = 0;c < Lx;++c)
          Scal(val,(*this)[ r*Lx + c ]);
 
+   this->touch();
+
 }
 
 /**
- * @param mpx will be written to file
- * @param filename name of the file
- * save the MPX object to a file in binary format.
+ * append the PEPS to a buffer as a binary checkpoint block: a checkpoint::Header, one checkpoint::Site record per site and the raw tensor data
+ * @param buffer output: the block is appended to it
  */
 template<typename T>
-void PEPS<T>::save(const char *filename){
+void PEPS<T>::serialize(vector<char> &buffer) const {
 
-   for(int row = 0;row < Ly;++row)
-      for(int col = 0;col < Lx;++col){
+   size_t start = buffer.size();
 
-         char name[200];
+   checkpoint::Header header;
+   memset(&header,0,sizeof(header));
 
-         sprintf(name,"%s/site_(%d,%d).peps",filename,row,col);
+   strncpy(header.magic,"PEPSBIN",8);
 
-         std::ofstream fout(name);
-         fout.precision(16);
+   header.version = checkpoint::VERSION;
+   header.dtype = checkpoint::dtype<T>();
 
-         int Da = (*this)(row,col).shape(0);
-         int Db = (*this)(row,col).shape(1);
-         int Dc = (*this)(row,col).shape(2);
-         int Dd = (*this)(row,col).shape(3);
-         int De = (*this)(row,col).shape(4);
+   header.Lx = Lx;
+   header.Ly = Ly;
+   header.d = d;
+   header.D = D;
 
-         fout << Da << "\t" << Db << "\t" << Dc << "\t" << Dd << "\t" << De << endl;
+   header.data = sizeof(checkpoint::Header) + Lx * Ly * sizeof(checkpoint::Site);
 
-         for(int a_ = 0;a_ < Da;++a_)
-            for(int b_ = 0;b_ < Db;++b_)
-               for(int c_ = 0;c_ < Dc;++c_)
-                  for(int d_ = 0;d_ < Dd;++d_)
-                     for(int e_ = 0;e_ < De;++e_)
-                        fout << std::scientific << a_ << "\t" << b_ << "\t" << c_ << "\t" << d_ << "\t" << e_ << "\t" << (*this)(row,col)(a_,b_,c_,d_,e_) << endl;
+   //site table
+   vector<checkpoint::Site> sites(Lx * Ly);
+
+   uint64_t offset = 0;
+
+   for(int i = 0;i < Lx * Ly;++i){
+
+      for(int j = 0;j < 5;++j)
+         sites[i].shape[j] = (*this)[i].shape(j);
+
+      sites[i].offset = offset;
+      offset += (*this)[i].size() * sizeof(T);
+
+   }
+
+   header.bytes = offset;
+
+   //one allocation for the whole block
+   buffer.reserve(start + header.data + header.bytes);
+
+   checkpoint::put(buffer,header);
+
+   for(int i = 0;i < Lx * Ly;++i)
+      checkpoint::put(buffer,sites[i]);
+
+   for(int i = 0;i < Lx * Ly;++i){
+
+      const char *ptr = reinterpret_cast<const char *>((*this)[i].data());
+      buffer.insert(buffer.end(),ptr,ptr + (*this)[i].size() * sizeof(T));
+
+   }
+
+   //fill in the checksum afterwards, it was zero in the header while it was calculated
+   header.checksum = checkpoint::checksum(buffer.data() + start,header.data + header.bytes);
+
+   memcpy(buffer.data() + start,&header,sizeof(header));
+
+}
+
+/**
+ * read the PEPS from a binary checkpoint block in memory, the tensors are copied directly. The checksum and the extent of every site are
+ * checked against the block first, so a truncated or corrupted file gives an error and leaves the PEPS untouched
+ * @param block pointer to the start of the block
+ * @param length nr of bytes available from block on
+ * @return the size of the block in bytes
+ */
+template<typename T>
+size_t PEPS<T>::deserialize(const char *block,size_t length){
+
+   //not BTAS_THROW: these have to be checked in optimized builds as well
+   if(length < sizeof(checkpoint::Header))
+      throw std::runtime_error("PEPS::deserialize: block too small");
+
+   checkpoint::Header header;
+   memcpy(&header,block,sizeof(header));
+
+   if(strncmp(header.magic,"PEPSBIN",8) != 0)
+      throw std::runtime_error("PEPS::deserialize: not a PEPS checkpoint");
+
+   if(header.version != checkpoint::VERSION)
+      throw std::runtime_error("PEPS::deserialize: unknown format version");
+
+   if(header.dtype != checkpoint::dtype<T>())
+      throw std::runtime_error("PEPS::deserialize: wrong data type");
+
+   if(header.Lx != Lx || header.Ly != Ly || header.d != d)
+      throw std::runtime_error("PEPS::deserialize: lattice dimensions do not match");
+
+   if(header.data != sizeof(checkpoint::Header) + Lx * Ly * sizeof(checkpoint::Site))
+      throw std::runtime_error("PEPS::deserialize: site table has the wrong size");
+
+   if(header.data > length || header.bytes > length - header.data)
+      throw std::runtime_error("PEPS::deserialize: block is truncated");
+
+   //the checksum covers the header, with the checksum itself at zero, the site table and the data
+   uint64_t stored = header.checksum;
+   header.checksum = 0;
+
+   uint64_t hash = checkpoint::checksum(reinterpret_cast<const char *>(&header),sizeof(header));
+   hash = checkpoint::checksum(block + sizeof(header),header.data + header.bytes - sizeof(header),hash);
+
+   if(hash != stored)
+      throw std::runtime_error("PEPS::deserialize: checksum mismatch");
+
+   //every site has to lie inside the data, checked before anything is copied
+   vector<checkpoint::Site> sites(Lx * Ly);
+
+   const char *ptr = block + sizeof(checkpoint::Header);
+
+   for(int i = 0;i < Lx * Ly;++i){
+
+      checkpoint::get(ptr,sites[i]);
+
+      uint64_t size = sizeof(T);
+
+      for(int j = 0;j < 5;++j){
+
+         if(sites[i].shape[j] < 1 || (uint64_t)sites[i].shape[j] > header.bytes / size)
+            throw std::runtime_error("PEPS::deserialize: site shape out of range");
+
+         size *= sites[i].shape[j];
 
       }
 
+      if(sites[i].offset > header.bytes || size > header.bytes - sites[i].offset)
+         throw std::runtime_error("PEPS::deserialize: site lies outside the data");
+
+   }
+
+   const char *data = block + header.data;
+
+   for(int i = 0;i < Lx * Ly;++i){
+
+      const checkpoint::Site &site = sites[i];
+
+      (*this)[i].resize(site.shape[0],site.shape[1],site.shape[2],site.shape[3],site.shape[4]);
+
+      memcpy((*this)[i].data(),data + site.offset,(*this)[i].size() * sizeof(T));
+
+   }
+
+   D = header.D;
+
+   this->touch();
+
+   return header.data + header.bytes;
+
 }
 
 /**
- * @param mpx will be constructed from file
+ * save the PEPS to a single binary checkpoint file. The tensors are copied into a staging buffer, which is written in the background:
+ * with one write, fsync and an atomic rename. Call checkpoint::wait() before the file is used.
  * @param filename name of the file
- * load the MPX object from a file in binary format.
+ */
+template<typename T>
+void PEPS<T>::save(const char *filename){
+
+   vector<char> *buffer = checkpoint::stage();
+   this->serialize(*buffer);
+
+   checkpoint::submit(filename,buffer,std::function<void(vector<char> &)>());
+
+}
+
+/**
+ * load the PEPS from a file written by save, which is mapped in memory. For migration, a directory is read as the old text format
+ * @param filename name of the file, or the directory of the text format
  */
 template<typename T>
 void PEPS<T>::load(const char *filename){
 
+   if(checkpoint::is_directory(filename)){
+
+      this->load_txt(filename);
+      return;
+
+   }
+
+   size_t length;
+   const char *block = checkpoint::map(filename,length);
+
+   try {
+
+      this->deserialize(block,length);
+
+   }
+   catch(...){
+
+      checkpoint::unmap(block,length);
+      throw;
+
+   }
+
+   checkpoint::unmap(block,length);
+
+}
+
+/**
+ * load the PEPS from the old text format: one file site_(row,col).peps per site, every element printed with its indices
+ * @param filename name of the directory containing the site files
+ */
+template<typename T>
+void PEPS<T>::load_txt(const char *filename){
+
    for(int row = 0;row < Ly;++row)
       for(int col = 0;col < Lx;++col){
 
@@ -744,64 +968,41 @@ void PEPS<T>::load(const char *filename){
 
       }
 
+   this->touch();
+
 }
 
 /**
- * evaluate the expectation value of the energy for the nn-Heisenberg model
- * beware, the environments have to be constructed beforehand!
+ * energy contribution of the bottom two rows (0 and 1), closed by the top layer env.gt(0). The 'delta' terms of the Hamiltonian are
+ * stacked along an extra leading operator index: every step of the left going operators is a single contraction over all terms, and the
+ * coefficients are summed in when the right operators close the chain.
+ * @param R the right renormalized operators of the bottom two rows, as constructed by contractions::init_ro('b',...)
+ * @return the energy of the bonds within and between rows 0 and 1
  */
 template<>
-double PEPS<double>::energy(){
-
-   // ---- || evaluate the energy in an MPO/MPS manner, first from bottom to top, then left to right || ----
-   int delta = ham.gdelta();
-
-   // #################################################################
-   // ### ---- from bottom to top: contract in mps/mpo fashion ---- ### 
-   // #################################################################
-
-   // -- (1) -- || bottom row: similar to overlap calculation
-
-   //first construct the right renormalized operators
-   vector< DArray<5> > R(Lx);
-   contractions::init_ro('b',*this,R); 
+double PEPS<double>::energy_bottom(const vector< DArray<5> > &R) const {
 
    //left going unity
    DArray<5> L(1,1,1,1,1);
    L = 1.0;
 
-   //left going operators: Li
-   std::vector< DArray<5> > Li_u( delta ); //upper site with extra operator
-   std::vector< DArray<5> > Li_d( delta ); //lower site with extra operator
+   //left going operators with the operator index as first leg
+   DArray<6> Li_u; //upper site with extra operator
+   DArray<6> Li_d; //lower site with extra operator
 
    //some storage stuff:
-   DArray<4> tmp4;
-   DArray<4> tmp4bis;
-
    DArray<5> tmp5;
-   DArray<5> tmp5bis;
-   DArray<5> perm5;
-
-   DArray<6> tmp6;
-   DArray<6> tmp6bis;
-   DArray<6> perm6;
 
    DArray<7> tmp7;
-   DArray<7> tmp7bis;
-   DArray<7> perm7;
 
    DArray<8> tmp8;
-   DArray<8> tmp8bis;
-   DArray<8> perm8;
-
-   DArray<9> tmp9;
-   DArray<9> tmp9bis;
-   DArray<9> perm9;
+   DArray<8> tmp8s;
 
-   enum {j,k,l,m,n,o};
+   DArray<9> tmp9s;
+   DArray<9> tmp9sbis;
 
-   //peps contracted with a local operator
-   DArray<5> peps_op;
+   //stack of peps contracted with the local operators
+   DArray<6> peps_op;
 
    //energy will be stored here
    double val = 0.0;
@@ -819,53 +1020,37 @@ double PEPS<double>::energy(){
       tmp8.clear();
       Contract(1.0,tmp7,shape(0,4),(*this)(1,col),shape(0,1),0.0,tmp8);
 
-      //add upper operator for Lu_i and vertical contribution
-      for(int i = 0;i < delta;++i){
-
-         //add left operator on top site
-         peps_op.clear();
-         Contract(1.0,ham.gL(i),shape(j,k),(*this)(1,col),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
-
-         tmp7.clear();
-         Contract(1.0,tmp8,shape(0,3,5),peps_op,shape(0,1,2),0.0,tmp7);
+      //add the left operators on top site
+      contractions::apply_stack(ham.gL_stack(),(*this)(1,col),peps_op);
+      contractions::open_stack(tmp8,shape(0,3,5),peps_op,tmp8s);
 
-         //paste bottom regular peps on
-         tmp8bis.clear();
-         Contract(1.0,tmp7,shape(0,3),(*this)(0,col),shape(0,1),0.0,tmp8bis);
-
-         //1) first make the vertical energy contribution
-         peps_op.clear();
-         Contract(1.0,ham.gR(i),shape(j,k),(*this)(0,col),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      //paste bottom regular peps on
+      tmp9s.clear();
+      Contract(1.0,tmp8s,shape(1,4),(*this)(0,col),shape(0,1),0.0,tmp9s);
 
-         Li_u[i].clear();
-         Contract(1.0,tmp8bis,shape(0,3,5,6),peps_op,shape(0,1,2,3),0.0,Li_u[i]);
+      //1) first make the vertical energy contribution: sum over the terms
+      contractions::apply_stack(ham.gR_n(),(*this)(0,col),peps_op);
 
-         val += ham.gcoef_n(i) * Dot(Li_u[i],R[col]);
+      tmp5.clear();
+      Contract(1.0,tmp9s,shape(0,1,4,6,7),peps_op,shape(0,1,2,3,4),0.0,tmp5);
 
-         //2) the construct the 'real' Lu_i
-         Contract(1.0,tmp8bis,shape(0,3,5,6),(*this)(0,col),shape(0,1,2,3),0.0,Li_u[i]);
+      val += Dot(tmp5,R[col]);
 
-      }
+      //2) the construct the 'real' Lu
+      Li_u.clear();
+      Contract(1.0,tmp9s,shape(1,4,6,7),(*this)(0,col),shape(0,1,2,3),0.0,Li_u);
 
       //add regular peps to tmp8
       tmp7.clear();
       Contract(1.0,tmp8,shape(0,3,5),(*this)(1,col),shape(0,1,2),0.0,tmp7);
-      
+
       //paste bottom regular peps on
       tmp8.clear();
       Contract(1.0,tmp7,shape(0,3),(*this)(0,col),shape(0,1),0.0,tmp8);
 
-      //then construct the lower operator Ld_i
-      for(int i = 0;i < delta;++i){
-
-         //construct lower left operator
-         peps_op.clear();
-         Contract(1.0,ham.gL(i),shape(j,k),(*this)(0,col),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
-
-         Li_d[i].clear();
-         Contract(1.0,tmp8,shape(0,3,5,6),peps_op,shape(0,1,2,3),0.0,Li_d[i]);
-
-      }
+      //then construct the lower operator Ld
+      contractions::apply_stack(ham.gL_stack(),(*this)(0,col),peps_op);
+      contractions::open_stack(tmp8,shape(0,3,5,6),peps_op,Li_d);
 
       //finally make new unity by adding one more regular peps
       L.clear();
@@ -873,84 +1058,68 @@ double PEPS<double>::energy(){
 
       // (B) then close down the left renormalized operators for lurd,ldru and horizontal terms
 
-      //start with Left Up
-      for(int i = 0;i < delta;++i){
-
-         //first add top to left unity L:
-         tmp7.clear();
-         Contract(1.0,Li_u[i],shape(0),env.gt(0)[col+1],shape(0),0.0,tmp7);
-
-         //add peps
-         tmp8.clear();
-         Contract(1.0,tmp7,shape(0,4),(*this)(1,col+1),shape(0,1),0.0,tmp8);
+      //start with Left Up: first add top
+      tmp8s.clear();
+      Contract(1.0,Li_u,shape(1),env.gt(0)[col+1],shape(0),0.0,tmp8s);
 
-         tmp7.clear();
-         Contract(1.0,tmp8,shape(0,3,5),(*this)(1,col+1),shape(0,1,2),0.0,tmp7);
+      //add peps
+      tmp9s.clear();
+      Contract(1.0,tmp8s,shape(1,5),(*this)(1,col+1),shape(0,1),0.0,tmp9s);
 
-         //paste bottom regular peps on
-         tmp8.clear();
-         Contract(1.0,tmp7,shape(0,3),(*this)(0,col+1),shape(0,1),0.0,tmp8);
+      tmp8s.clear();
+      Contract(1.0,tmp9s,shape(1,4,6),(*this)(1,col+1),shape(0,1,2),0.0,tmp8s);
 
-         //and construct the left up-down operator
-         peps_op.clear();
-         Contract(1.0,ham.gR(i),shape(j,k),(*this)(0,col+1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      //paste bottom regular peps on
+      tmp9s.clear();
+      Contract(1.0,tmp8s,shape(1,4),(*this)(0,col+1),shape(0,1),0.0,tmp9s);
 
-         Li_u[i].clear();
-         Contract(1.0,tmp8,shape(0,3,5,6),peps_op,shape(0,1,2,3),0.0,Li_u[i]);
+      //and close with the right operators: lurd diagonal
+      contractions::apply_stack(ham.gR_nn(),(*this)(0,col+1),peps_op);
 
-         val += ham.gcoef_nn(i) * Dot(Li_u[i],R[col+1]);
+      tmp5.clear();
+      Contract(1.0,tmp9s,shape(0,1,4,6,7),peps_op,shape(0,1,2,3,4),0.0,tmp5);
 
-      }
+      val += Dot(tmp5,R[col+1]);
 
       //Left down - close down with a diagonal and horizontal term!
-      for(int i = 0;i < delta;++i){
-
-         //first add on top to Left renormalized operator
-         tmp7.clear();
-         Contract(1.0,Li_d[i],shape(0),env.gt(0)[col+1],shape(0),0.0,tmp7);
-
-         //add peps
-         tmp8.clear();
-         Contract(1.0,tmp7,shape(0,4),(*this)(1,col+1),shape(0,1),0.0,tmp8);
+      tmp8s.clear();
+      Contract(1.0,Li_d,shape(1),env.gt(0)[col+1],shape(0),0.0,tmp8s);
 
-         //1) do the diagonal link first
-         peps_op.clear();
-         Contract(1.0,ham.gR(i),shape(j,k),(*this)(1,col+1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
-
-         tmp7.clear();
-         Contract(1.0,tmp8,shape(0,3,5),peps_op,shape(0,1,2),0.0,tmp7);
+      //add peps
+      tmp9s.clear();
+      Contract(1.0,tmp8s,shape(1,5),(*this)(1,col+1),shape(0,1),0.0,tmp9s);
 
-         //paste bottom regular peps on
-         tmp8bis.clear();
-         Contract(1.0,tmp7,shape(0,3),(*this)(0,col+1),shape(0,1),0.0,tmp8bis);
+      //1) do the diagonal link first
+      contractions::apply_stack(ham.gR_nn(),(*this)(1,col+1),peps_op);
 
-         //and again
-         tmp5.clear();
-         Contract(1.0,tmp8bis,shape(0,3,5,6),(*this)(0,col+1),shape(0,1,2,3),0.0,tmp5);
+      tmp7.clear();
+      Contract(1.0,tmp9s,shape(0,1,4,6),peps_op,shape(0,1,2,3),0.0,tmp7);
 
-         //energy:
-         val += ham.gcoef_nn(i) * Dot(tmp5,R[col+1]);
+      //paste bottom regular peps on
+      tmp8.clear();
+      Contract(1.0,tmp7,shape(0,3),(*this)(0,col+1),shape(0,1),0.0,tmp8);
 
-         //2) then do the horizontal gate:
+      //and again
+      tmp5.clear();
+      Contract(1.0,tmp8,shape(0,3,5,6),(*this)(0,col+1),shape(0,1,2,3),0.0,tmp5);
 
-         //add regular peps
-         tmp7.clear();
-         Contract(1.0,tmp8,shape(0,3,5),(*this)(1,col+1),shape(0,1,2),0.0,tmp7);
+      //energy:
+      val += Dot(tmp5,R[col+1]);
 
-         //paste bottom regular peps on
-         tmp8.clear();
-         Contract(1.0,tmp7,shape(0,3),(*this)(0,col+1),shape(0,1),0.0,tmp8);
+      //2) then do the horizontal gate:
+      tmp8s.clear();
+      Contract(1.0,tmp9s,shape(1,4,6),(*this)(1,col+1),shape(0,1,2),0.0,tmp8s);
 
-         //construct the left down-down operator (horizontal gate)
-         peps_op.clear();
-         Contract(1.0,ham.gR(i),shape(j,k),(*this)(0,col+1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      //paste bottom regular peps on
+      tmp9sbis.clear();
+      Contract(1.0,tmp8s,shape(1,4),(*this)(0,col+1),shape(0,1),0.0,tmp9sbis);
 
-         tmp5.clear();
-         Contract(1.0,tmp8,shape(0,3,5,6),peps_op,shape(0,1,2,3),0.0,tmp5);
+      contractions::apply_stack(ham.gR_n(),(*this)(0,col+1),peps_op);
 
-         val += ham.gcoef_n(i) * Dot(tmp5,R[col+1]);
+      tmp5.clear();
+      Contract(1.0,tmp9sbis,shape(0,1,4,6,7),peps_op,shape(0,1,2,3,4),0.0,tmp5);
 
-      }
+      val += Dot(tmp5,R[col+1]);
 
    }
 
@@ -962,334 +1131,305 @@ double PEPS<double>::energy(){
    tmp8.clear();
    Contract(1.0,tmp7,shape(0,4),(*this)(1,Lx-1),shape(0,1),0.0,tmp8);
 
-   //add upper operator
-   for(int i = 0;i < delta;++i){
-
-      //add left operator on top site
-      peps_op.clear();
-      Contract(1.0,ham.gL(i),shape(j,k),(*this)(1,Lx-1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
-
-      tmp7.clear();
-      Contract(1.0,tmp8,shape(0,3,5),peps_op,shape(0,1,2),0.0,tmp7);
+   //add upper operators
+   contractions::apply_stack(ham.gL_stack(),(*this)(1,Lx-1),peps_op);
+   contractions::open_stack(tmp8,shape(0,3,5),peps_op,tmp8s);
 
-      //paste bottom regular peps on
-      tmp8bis.clear();
-      Contract(1.0,tmp7,shape(0,3),(*this)(0,Lx-1),shape(0,1),0.0,tmp8bis);
+   //paste bottom regular peps on
+   tmp9s.clear();
+   Contract(1.0,tmp8s,shape(1,4),(*this)(0,Lx-1),shape(0,1),0.0,tmp9s);
 
-      //1) first make the vertical energy contribution
-      peps_op.clear();
-      Contract(1.0,ham.gR(i),shape(j,k),(*this)(0,Lx-1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+   contractions::apply_stack(ham.gR_n(),(*this)(0,Lx-1),peps_op);
 
-      Li_u[i].clear();
-      Contract(1.0,tmp8bis,shape(0,3,5,6),peps_op,shape(0,1,2,3),0.0,Li_u[i]);
+   tmp5.clear();
+   Contract(1.0,tmp9s,shape(0,1,4,6,7),peps_op,shape(0,1,2,3,4),0.0,tmp5);
 
-      val += ham.gcoef_n(i) * Dot(Li_u[i],R[Lx-1]);
+   val += Dot(tmp5,R[Lx-1]);
 
-   }
+   return val;
 
-   // -- (2) -- now move from bottom to top calculating everything like an MPO/MPS expectation value
+}
 
-   //Right renormalized operators
-   vector< DArray<6> > RO(Lx);
+/**
+ * energy contribution of the row pair (row,row+1), between the layers env.gb(row-1) and env.gt(row), with the terms of the Hamiltonian
+ * stacked as in energy_bottom
+ * @param row lower row of the pair, 1 <= row < Ly - 2
+ * @param RO the right renormalized operators of the pair, as constructed by contractions::init_ro(row,...)
+ * @return the energy of the bonds within row + 1 and between rows row and row + 1
+ */
+template<>
+double PEPS<double>::energy_row(int row,const vector< DArray<6> > &RO) const {
 
    //left unity
    DArray<6> LO;
 
-   //array of delta left upper and lower renormalized operators needed
-   std::vector< DArray<6> > LOi_u(delta);
-   std::vector< DArray<6> > LOi_d(delta);
-
-   for(int row = 1;row < Ly - 2;++row){
+   //left upper and lower renormalized operators with the operator index as first leg
+   DArray<7> LOi_u;
+   DArray<7> LOi_d;
 
-      //first create right renormalized operator
-      contractions::init_ro(row,*this,RO);
+   //some storage stuff:
+   DArray<6> tmp6;
 
-      LO.resize(shape(1,1,1,1,1,1));
-      LO = 1.0;
+   DArray<8> tmp8;
 
-      // --- move from left to right to get the expecation value of the interactions ---
-      for(int col = 0;col < Lx - 1;++col){
-         
-         // (A) construct left going operators and evaluate vertical term
+   DArray<9> tmp9;
+   DArray<9> tmp9s;
 
-         //first add top to left unit
-         tmp8.clear();
-         Contract(1.0,LO,shape(0),env.gt(row)[col],shape(0),0.0,tmp8);
+   DArray<10> tmp10s;
+   DArray<10> tmp10sbis;
 
-         //add regular upper peps to left
-         tmp9.clear();
-         Contract(1.0,tmp8,shape(0,5),(*this)(row+1,col),shape(0,1),0.0,tmp9);
+   //stack of peps contracted with the local operators
+   DArray<6> peps_op;
 
-         //construct Left Up operator first
-         for(int i = 0;i < delta;++i){
+   //energy will be stored here
+   double val = 0.0;
 
-            //add operator to upper peps
-            peps_op.clear();
-            Contract(1.0,ham.gL(i),shape(j,k),(*this)(row+1,col),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+   LO.resize(shape(1,1,1,1,1,1));
+   LO = 1.0;
 
-            tmp8.clear();
-            Contract(1.0,tmp9,shape(0,4,6),peps_op,shape(0,1,2),0.0,tmp8);
+   // --- move from left to right to get the expecation value of the interactions ---
+   for(int col = 0;col < Lx - 1;++col){
 
-            //add lower regular peps on
-            tmp9bis.clear();
-            Contract(1.0,tmp8,shape(0,4),(*this)(row,col),shape(0,1),0.0,tmp9bis);
+      // (A) construct left renormalized operators and vertical energy contribution
 
-            //add operator to lower peps for vertical gate
-            peps_op.clear();
-            Contract(1.0,ham.gR(i),shape(j,k),(*this)(row,col),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      //first add top to left unity
+      tmp8.clear();
+      Contract(1.0,LO,shape(0),env.gt(row)[col],shape(0),0.0,tmp8);
 
-            //and add on tmp9bis
-            tmp8.clear();
-            Contract(1.0,tmp9bis,shape(0,4,6),peps_op,shape(0,1,2),0.0,tmp8);
+      //add upper peps
+      tmp9.clear();
+      Contract(1.0,tmp8,shape(0,5),(*this)(row+1,col),shape(0,1),0.0,tmp9);
 
-            LOi_u[i].clear();
-            Contract(1.0,tmp8,shape(0,4,6),env.gb(row-1)[col],shape(0,1,2),0.0,LOi_u[i]);
+      //add the left operators to the upper peps
+      contractions::apply_stack(ham.gL_stack(),(*this)(row+1,col),peps_op);
+      contractions::open_stack(tmp9,shape(0,4,6),peps_op,tmp9s);
 
-            //add vertical energy contribution
-            val += ham.gcoef_n(i) * Dot(LOi_u[i],RO[col]);
+      //add regular lower peps
+      tmp10s.clear();
+      Contract(1.0,tmp9s,shape(1,5),(*this)(row,col),shape(0,1),0.0,tmp10s);
 
-            //then construct Lu_i by adding regular peps to tmp9bis
-            Contract(1.0,tmp9bis,shape(0,4,6),(*this)(row,col),shape(0,1,2),0.0,tmp8);
+      //vertical: close with the right operators on the lower peps
+      contractions::apply_stack(ham.gR_n(),(*this)(row,col),peps_op);
 
-            //and add bottom environment
-            Contract(1.0,tmp8,shape(0,4,6),env.gb(row-1)[col],shape(0,1,2),0.0,LOi_u[i]);
+      tmp8.clear();
+      Contract(1.0,tmp10s,shape(0,1,5,7),peps_op,shape(0,1,2,3),0.0,tmp8);
 
-         }
+      //and the bottom environment
+      tmp6.clear();
+      Contract(1.0,tmp8,shape(0,4,6),env.gb(row-1)[col],shape(0,1,2),0.0,tmp6);
 
-         //add on regular upper peps to intermediate perm9
-         tmp8.clear();
-         Contract(1.0,tmp9,shape(0,4,6),(*this)(row+1,col),shape(0,1,2),0.0,tmp8);
+      //add vertical energy contribution
+      val += Dot(tmp6,RO[col]);
 
-         //add lower regular peps on
-         tmp9.clear();
-         Contract(1.0,tmp8,shape(0,4),(*this)(row,col),shape(0,1),0.0,tmp9);
+      //construct the left upper operator
+      tmp9s.clear();
+      Contract(1.0,tmp10s,shape(1,5,7),(*this)(row,col),shape(0,1,2),0.0,tmp9s);
 
-         //construct lower-left going operator
-         for(int i = 0;i < delta;++i){
+      LOi_u.clear();
+      Contract(1.0,tmp9s,shape(1,5,7),env.gb(row-1)[col],shape(0,1,2),0.0,LOi_u);
 
-            //add operator to lower peps
-            peps_op.clear();
-            Contract(1.0,ham.gL(i),shape(j,k),(*this)(row,col),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      //add regular upper peps
+      tmp8.clear();
+      Contract(1.0,tmp9,shape(0,4,6),(*this)(row+1,col),shape(0,1,2),0.0,tmp8);
 
-            //and add on tmp9
-            tmp8.clear();
-            Contract(1.0,tmp9,shape(0,4,6),peps_op,shape(0,1,2),0.0,tmp8);
+      //and regular lower peps
+      tmp9.clear();
+      Contract(1.0,tmp8,shape(0,4),(*this)(row,col),shape(0,1),0.0,tmp9);
 
-            //and add bottom environment for LOi_d[i] construction
-            LOi_d[i].clear();
-            Contract(1.0,tmp8,shape(0,4,6),env.gb(row-1)[col],shape(0,1,2),0.0,LOi_d[i]);
+      //left lower operator: the left operators on the lower peps
+      contractions::apply_stack(ham.gL_stack(),(*this)(row,col),peps_op);
+      contractions::open_stack(tmp9,shape(0,4,6),peps_op,tmp9s);
 
-         }
+      LOi_d.clear();
+      Contract(1.0,tmp9s,shape(1,5,7),env.gb(row-1)[col],shape(0,1,2),0.0,LOi_d);
 
-         //finally left unit operator: add on another regular lower peps
-         tmp8.clear();
-         Contract(1.0,tmp9,shape(0,4,6),(*this)(row,col),shape(0,1,2),0.0,tmp8);
+      //new left unity
+      tmp8.clear();
+      Contract(1.0,tmp9,shape(0,4,6),(*this)(row,col),shape(0,1,2),0.0,tmp8);
 
-         LO.clear();
-         Contract(1.0,tmp8,shape(0,4,6),env.gb(row-1)[col],shape(0,1,2),0.0,LO);
+      LO.clear();
+      Contract(1.0,tmp8,shape(0,4,6),env.gb(row-1)[col],shape(0,1,2),0.0,LO);
 
-         // (B) close down the left up and down operators with two diagonal and one horizontal contribution
-         
-         //start with Left Up
-         for(int i = 0;i < delta;++i){
+      // (B) close down the left operators
 
-            //first add top to left-renormalized operator
-            tmp8.clear();
-            Contract(1.0,LOi_u[i],shape(0),env.gt(row)[col+1],shape(0),0.0,tmp8);
+      //left up: add top environment
+      tmp9s.clear();
+      Contract(1.0,LOi_u,shape(1),env.gt(row)[col+1],shape(0),0.0,tmp9s);
 
-            //add regular upper peps to left
-            tmp9.clear();
-            Contract(1.0,tmp8,shape(0,5),(*this)(row+1,col+1),shape(0,1),0.0,tmp9);
+      //add regular upper peps
+      tmp10s.clear();
+      Contract(1.0,tmp9s,shape(1,6),(*this)(row+1,col+1),shape(0,1),0.0,tmp10s);
 
-            //and another
-            tmp8.clear();
-            Contract(1.0,tmp9,shape(0,4,6),(*this)(row+1,col+1),shape(0,1,2),0.0,tmp8);
+      tmp9s.clear();
+      Contract(1.0,tmp10s,shape(1,5,7),(*this)(row+1,col+1),shape(0,1,2),0.0,tmp9s);
 
-            //add lower regular peps on
-            tmp9.clear();
-            Contract(1.0,tmp8,shape(0,4),(*this)(row,col+1),shape(0,1),0.0,tmp9);
+      //add regular lower peps
+      tmp10s.clear();
+      Contract(1.0,tmp9s,shape(1,5),(*this)(row,col+1),shape(0,1),0.0,tmp10s);
 
-            //add operator to lower peps for vertical gate
-            peps_op.clear();
-            Contract(1.0,ham.gR(i),shape(j,k),(*this)(row,col+1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      //close with the right operators on the lower peps
+      contractions::apply_stack(ham.gR_nn(),(*this)(row,col+1),peps_op);
 
-            //and add on tmp9
-            tmp8.clear();
-            Contract(1.0,tmp9,shape(0,4,6),peps_op,shape(0,1,2),0.0,tmp8);
+      tmp8.clear();
+      Contract(1.0,tmp10s,shape(0,1,5,7),peps_op,shape(0,1,2,3),0.0,tmp8);
 
-            //add bottom environment
-            tmp6.clear();
-            Contract(1.0,tmp8,shape(0,4,6),env.gb(row-1)[col+1],shape(0,1,2),0.0,tmp6);
+      //add bottom environment
+      tmp6.clear();
+      Contract(1.0,tmp8,shape(0,4,6),env.gb(row-1)[col+1],shape(0,1,2),0.0,tmp6);
 
-            //diagonal-lurd energy contribution
-            val += ham.gcoef_nn(i) * Dot(tmp6,RO[col+1]);
+      //diagonal-lurd energy contribution
+      val += Dot(tmp6,RO[col+1]);
 
-         }
+      //left down: add top environment
+      tmp9s.clear();
+      Contract(1.0,LOi_d,shape(1),env.gt(row)[col+1],shape(0),0.0,tmp9s);
 
-         //Left down - close down with a diagonal and horizontal term!
-         for(int i = 0;i < delta;++i){
+      //add regular upper peps
+      tmp10s.clear();
+      Contract(1.0,tmp9s,shape(1,6),(*this)(row+1,col+1),shape(0,1),0.0,tmp10s);
 
-            //first add top to left-renormalized operator
-            tmp8.clear();
-            Contract(1.0,LOi_d[i],shape(0),env.gt(row)[col+1],shape(0),0.0,tmp8);
+      //1) diagonal: close with the right operators on the upper peps
+      contractions::apply_stack(ham.gR_nn(),(*this)(row+1,col+1),peps_op);
 
-            //add regular upper peps to left
-            tmp9.clear();
-            Contract(1.0,tmp8,shape(0,5),(*this)(row+1,col+1),shape(0,1),0.0,tmp9);
+      tmp8.clear();
+      Contract(1.0,tmp10s,shape(0,1,5,7),peps_op,shape(0,1,2,3),0.0,tmp8);
 
-            //1) do the diagonal link first
-            peps_op.clear();
-            Contract(1.0,ham.gR(i),shape(j,k),(*this)(row+1,col+1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      //add regular lower peps
+      tmp9.clear();
+      Contract(1.0,tmp8,shape(0,4),(*this)(row,col+1),shape(0,1),0.0,tmp9);
 
-            tmp8.clear();
-            Contract(1.0,tmp9,shape(0,4,6),peps_op,shape(0,1,2),0.0,tmp8);
+      tmp8.clear();
+      Contract(1.0,tmp9,shape(0,4,6),(*this)(row,col+1),shape(0,1,2),0.0,tmp8);
 
-            //add lower regular peps on
-            tmp9bis.clear();
-            Contract(1.0,tmp8,shape(0,4),(*this)(row,col+1),shape(0,1),0.0,tmp9bis);
+      //add bottom environment
+      tmp6.clear();
+      Contract(1.0,tmp8,shape(0,4,6),env.gb(row-1)[col+1],shape(0,1,2),0.0,tmp6);
 
-            //and another
-            tmp8.clear();
-            Contract(1.0,tmp9bis,shape(0,4,6),(*this)(row,col+1),shape(0,1,2),0.0,tmp8);
+      //diagnoal-ldru energy:
+      val += Dot(tmp6,RO[col+1]);
 
-            //and add bottom environment
-            tmp6.clear();
-            Contract(1.0,tmp8,shape(0,4,6),env.gb(row-1)[col+1],shape(0,1,2),0.0,tmp6);
+      //2) horizontal: add regular upper peps
+      tmp9s.clear();
+      Contract(1.0,tmp10s,shape(1,5,7),(*this)(row+1,col+1),shape(0,1,2),0.0,tmp9s);
 
-            //diagnoal-ldru energy:
-            val += ham.gcoef_nn(i) * Dot(tmp6,RO[col+1]);
+      //add regular lower peps
+      tmp10sbis.clear();
+      Contract(1.0,tmp9s,shape(1,5),(*this)(row,col+1),shape(0,1),0.0,tmp10sbis);
 
-            //2) then do the horizontal gate:
+      //close with the right operators on the lower peps
+      contractions::apply_stack(ham.gR_n(),(*this)(row,col+1),peps_op);
 
-            //add regular top peps to intermediate tmp9
-            tmp8.clear();
-            Contract(1.0,tmp9,shape(0,4,6),(*this)(row+1,col+1),shape(0,1,2),0.0,tmp8);
+      tmp8.clear();
+      Contract(1.0,tmp10sbis,shape(0,1,5,7),peps_op,shape(0,1,2,3),0.0,tmp8);
 
-            //add lower regular peps on
-            tmp9bis.clear();
-            Contract(1.0,tmp8,shape(0,4),(*this)(row,col+1),shape(0,1),0.0,tmp9bis);
+      //add bottom environment
+      tmp6.clear();
+      Contract(1.0,tmp8,shape(0,4,6),env.gb(row-1)[col+1],shape(0,1,2),0.0,tmp6);
 
-            //construct the left down-down operator (horizontal gate)
-            peps_op.clear();
-            Contract(1.0,ham.gR(i),shape(j,k),(*this)(row,col+1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      //horizontal energy contribution
+      val += Dot(tmp6,RO[col+1]);
 
-            //add interaction term
-            tmp8.clear();
-            Contract(1.0,tmp9bis,shape(0,4,6),peps_op,shape(0,1,2),0.0,tmp8);
+   }
 
-            //and add bottom environment
-            tmp6.clear();
-            Contract(1.0,tmp8,shape(0,4,6),env.gb(row-1)[col+1],shape(0,1,2),0.0,tmp6);
+   //last site of the row: vertical term
+   tmp8.clear();
+   Contract(1.0,LO,shape(0),env.gt(row)[Lx-1],shape(0),0.0,tmp8);
 
-            //horizontal energy contribution
-            val += ham.gcoef_n(i) * Dot(tmp6,RO[col+1]);
+   tmp9.clear();
+   Contract(1.0,tmp8,shape(0,5),(*this)(row+1,Lx-1),shape(0,1),0.0,tmp9);
 
-         }
+   contractions::apply_stack(ham.gL_stack(),(*this)(row+1,Lx-1),peps_op);
+   contractions::open_stack(tmp9,shape(0,4,6),peps_op,tmp9s);
 
-      }
+   tmp10s.clear();
+   Contract(1.0,tmp9s,shape(1,5),(*this)(row,Lx-1),shape(0,1),0.0,tmp10s);
 
-      //last vertical gate
+   contractions::apply_stack(ham.gR_n(),(*this)(row,Lx-1),peps_op);
 
-      //first add top to left unit
-      tmp8.clear();
-      Contract(1.0,LO,shape(0),env.gt(row)[Lx-1],shape(0),0.0,tmp8);
+   tmp8.clear();
+   Contract(1.0,tmp10s,shape(0,1,5,7),peps_op,shape(0,1,2,3),0.0,tmp8);
 
-      //add regular upper peps to left
-      tmp9.clear();
-      Contract(1.0,tmp8,shape(0,5),(*this)(row+1,Lx-1),shape(0,1),0.0,tmp9);
+   tmp6.clear();
+   Contract(1.0,tmp8,shape(0,4,6),env.gb(row-1)[Lx-1],shape(0,1,2),0.0,tmp6);
 
-      //construct Left Up operator first
-      for(int i = 0;i < delta;++i){
+   //add vertical energy contribution
+   val += Dot(tmp6,RO[Lx-1]);
 
-         //add operator to upper peps
-         peps_op.clear();
-         Contract(1.0,ham.gL(i),shape(j,k),(*this)(row+1,Lx-1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+   return val;
 
-         tmp8.clear();
-         Contract(1.0,tmp9,shape(0,4,6),peps_op,shape(0,1,2),0.0,tmp8);
+}
 
-         //add lower regular peps on
-         tmp9bis.clear();
-         Contract(1.0,tmp8,shape(0,4),(*this)(row,Lx-1),shape(0,1),0.0,tmp9bis);
+/**
+ * energy contribution of the top two rows (Ly-2 and Ly-1), closed by the bottom layer env.gb(Ly-3), with the terms of the Hamiltonian
+ * stacked as in energy_bottom
+ * @param R the right renormalized operators of the top two rows, as constructed by contractions::init_ro('t',...)
+ * @return the energy of the bonds within row Ly-1 and between rows Ly-2 and Ly-1
+ */
+template<>
+double PEPS<double>::energy_top(const vector< DArray<5> > &R) const {
 
-         //add operator to lower peps for vertical gate
-         peps_op.clear();
-         Contract(1.0,ham.gR(i),shape(j,k),(*this)(row,Lx-1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+   DArray<5> L;
 
-         //and add on tmp9bis
-         tmp8.clear();
-         Contract(1.0,tmp9bis,shape(0,4,6),peps_op,shape(0,1,2),0.0,tmp8);
+   //left going operators with the operator index as first leg
+   DArray<6> Li_u; //upper site with extra operator
+   DArray<6> Li_d; //lower site with extra operator
 
-         LOi_u[i].clear();
-         Contract(1.0,tmp8,shape(0,4,6),env.gb(row-1)[Lx-1],shape(0,1,2),0.0,LOi_u[i]);
+   //some storage stuff:
+   DArray<5> tmp5;
 
-         //add vertical energy contribution
-         val += ham.gcoef_n(i) * Dot(LOi_u[i],RO[Lx-1]);
+   DArray<7> tmp7;
 
-      }
+   DArray<8> tmp8;
+   DArray<8> tmp8s;
 
-   }
+   DArray<9> tmp9s;
+   DArray<9> tmp9sbis;
 
-   // -- (3) -- || top row = Ly-1: again similar to overlap calculation
+   //stack of peps contracted with the local operators
+   DArray<6> peps_op;
 
-   //first construct the right renormalized operators
-   contractions::init_ro('t',*this,R);
+   //energy will be stored here
+   double val = 0.0;
 
    L.resize(shape(1,1,1,1,1));
    L = 1.0;
 
-   //construct the left going operators and the vertical energy contribution
-
    //middle of the chain:
    for(int col = 0;col < Lx-1;++col){
 
       // (A) construct left renormalized operators and vertical energy contribution
-      
+
       //add top peps to left
       tmp8.clear();
       Contract(1.0,L,shape(0),(*this)(Ly-1,col),shape(0),0.0,tmp8);
 
-      //construct Left Up operator first
-      for(int i = 0;i < delta;++i){
-
-         //add operator to upper peps
-         peps_op.clear();
-         Contract(1.0,ham.gL(i),shape(j,k),(*this)(Ly-1,col),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      //add the left operators to the upper peps
+      contractions::apply_stack(ham.gL_stack(),(*this)(Ly-1,col),peps_op);
+      contractions::open_stack(tmp8,shape(0,4,5),peps_op,tmp8s);
 
-         //add to tmp8
-         tmp7.clear();
-         Contract(1.0,tmp8,shape(0,4,5),peps_op,shape(0,1,2),0.0,tmp7);
-
-         //add regular peps
-         tmp8bis.clear();
-         Contract(1.0,tmp7,shape(0,3),(*this)(Ly-2,col),shape(0,1),0.0,tmp8bis);
-
-         //right operator to lower peps
-         peps_op.clear();
-         Contract(1.0,ham.gR(i),shape(j,k),(*this)(Ly-2,col),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      //add regular peps
+      tmp9s.clear();
+      Contract(1.0,tmp8s,shape(1,4),(*this)(Ly-2,col),shape(0,1),0.0,tmp9s);
 
-         //add to tmp8bis
-         tmp7.clear();
-         Contract(1.0,tmp8bis,shape(0,3,5),peps_op,shape(0,1,2),0.0,tmp7);
+      //right operators to lower peps
+      contractions::apply_stack(ham.gR_n(),(*this)(Ly-2,col),peps_op);
 
-         //finally contract with bottom environment
-         tmp5.clear();
-         Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[col],shape(0,1,2),0.0,tmp5);
+      tmp7.clear();
+      Contract(1.0,tmp9s,shape(0,1,4,6),peps_op,shape(0,1,2,3),0.0,tmp7);
 
-         //vertical energy
-         val += ham.gcoef_n(i) * Dot(tmp5,R[col]);
+      //finally contract with bottom environment
+      tmp5.clear();
+      Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[col],shape(0,1,2),0.0,tmp5);
 
-         //construct Lu
+      //vertical energy
+      val += Dot(tmp5,R[col]);
 
-         //add regular peps to tmp8bis
-         tmp7.clear();
-         Contract(1.0,tmp8bis,shape(0,3,5),(*this)(Ly-2,col),shape(0,1,2),0.0,tmp7);
+      //construct Lu: add regular peps
+      tmp8s.clear();
+      Contract(1.0,tmp9s,shape(1,4,6),(*this)(Ly-2,col),shape(0,1,2),0.0,tmp8s);
 
-         //finally contract with bottom environment
-         Li_u[i].clear();
-         Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[col],shape(0,1,2),0.0,Li_u[i]);
-
-      }
+      Li_u.clear();
+      Contract(1.0,tmp8s,shape(1,4,6),env.gb(Ly-3)[col],shape(0,1,2),0.0,Li_u);
 
       //add regular upper peps to tmp8
       tmp7.clear();
@@ -1299,193 +1439,191 @@ double PEPS<double>::energy(){
       tmp8.clear();
       Contract(1.0,tmp7,shape(0,3),(*this)(Ly-2,col),shape(0,1),0.0,tmp8);
 
-      //then construct Left Down operator
-      for(int i = 0;i < delta;++i){
-
-         //left operator to lower peps
-         peps_op.clear();
-         Contract(1.0,ham.gL(i),shape(j,k),(*this)(Ly-2,col),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
-
-         //add to tmp8
-         tmp7.clear();
-         Contract(1.0,tmp8,shape(0,3,5),peps_op,shape(0,1,2),0.0,tmp7);
+      //then construct Left Down operator: left operators to lower peps
+      contractions::apply_stack(ham.gL_stack(),(*this)(Ly-2,col),peps_op);
+      contractions::open_stack(tmp8,shape(0,3,5),peps_op,tmp8s);
 
-         //finally contract with bottom environment
-         Li_d[i].clear();
-         Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[col],shape(0,1,2),0.0,Li_d[i]);
-
-      }
+      Li_d.clear();
+      Contract(1.0,tmp8s,shape(1,4,6),env.gb(Ly-3)[col],shape(0,1,2),0.0,Li_d);
 
       //finally make left unity
-
-      //add lower regular peps to tmp8
       tmp7.clear();
       Contract(1.0,tmp8,shape(0,3,5),(*this)(Ly-2,col),shape(0,1,2),0.0,tmp7);
 
-      //finally contract with bottom environment
       L.clear();
       Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[col],shape(0,1,2),0.0,L);
 
       // (B) close down the left operators
-      
-      //start with left-up
-      
-      //add top peps to left
-      for(int i = 0;i < delta;++i){
 
-         // -- top row horizontal -- 
-         tmp8.clear();
-         Contract(1.0,Li_u[i],shape(0),(*this)(Ly-1,col+1),shape(0),0.0,tmp8);
+      //start with left-up: add top peps
+      tmp9s.clear();
+      Contract(1.0,Li_u,shape(1),(*this)(Ly-1,col+1),shape(0),0.0,tmp9s);
+
+      // -- top row horizontal -- 
+      contractions::apply_stack(ham.gR_n(),(*this)(Ly-1,col+1),peps_op);
+
+      tmp7.clear();
+      Contract(1.0,tmp9s,shape(0,1,5,6),peps_op,shape(0,1,2,3),0.0,tmp7);
+
+      //add two regular lower peps
+      tmp8.clear();
+      Contract(1.0,tmp7,shape(0,3),(*this)(Ly-2,col+1),shape(0,1),0.0,tmp8);
 
-         //add operator to upper peps
-         peps_op.clear();
-         Contract(1.0,ham.gR(i),shape(j,k),(*this)(Ly-1,col+1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      tmp7.clear();
+      Contract(1.0,tmp8,shape(0,3,5),(*this)(Ly-2,col+1),shape(0,1,2),0.0,tmp7);
 
-         //add to tmp8
-         tmp7.clear();
-         Contract(1.0,tmp8,shape(0,4,5),peps_op,shape(0,1,2),0.0,tmp7);
+      //finally contract with bottom environment
+      tmp5.clear();
+      Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[col+1],shape(0,1,2),0.0,tmp5);
 
-         //add regular peps
-         tmp8bis.clear();
-         Contract(1.0,tmp7,shape(0,3),(*this)(Ly-2,col+1),shape(0,1),0.0,tmp8bis);
+      //top row horizontal energy contribution
+      val += Dot(tmp5,R[col+1]);
 
-         //add another regular lower peps to tmp8bis
-         tmp7.clear();
-         Contract(1.0,tmp8bis,shape(0,3,5),(*this)(Ly-2,col+1),shape(0,1,2),0.0,tmp7);
+      //-- lurd diagonal --
+      tmp8s.clear();
+      Contract(1.0,tmp9s,shape(1,5,6),(*this)(Ly-1,col+1),shape(0,1,2),0.0,tmp8s);
 
-         //finally contract with bottom environment
-         tmp5.clear();
-         Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[col+1],shape(0,1,2),0.0,tmp5);
+      tmp9sbis.clear();
+      Contract(1.0,tmp8s,shape(1,4),(*this)(Ly-2,col+1),shape(0,1),0.0,tmp9sbis);
 
-         //top row horizontal energy contribution
-         val += ham.gcoef_n(i) * Dot(tmp5,R[col+1]);
+      contractions::apply_stack(ham.gR_nn(),(*this)(Ly-2,col+1),peps_op);
 
-         //-- lurd diagonal --
+      tmp7.clear();
+      Contract(1.0,tmp9sbis,shape(0,1,4,6),peps_op,shape(0,1,2,3),0.0,tmp7);
 
-         //add regular upper peps to tmp8
-         tmp7.clear();
-         Contract(1.0,tmp8,shape(0,4,5),(*this)(Ly-1,col+1),shape(0,1,2),0.0,tmp7);
+      tmp5.clear();
+      Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[col+1],shape(0,1,2),0.0,tmp5);
 
-         //add regular lower peps
-         tmp8.clear();
-         Contract(1.0,tmp7,shape(0,3),(*this)(Ly-2,col+1),shape(0,1),0.0,tmp8);
+      //lurd diagonal energy contribution
+      val += Dot(tmp5,R[col+1]);
 
-         //add operator to lower peps
-         peps_op.clear();
-         Contract(1.0,ham.gR(i),shape(j,k),(*this)(Ly-2,col+1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      //then left down: add top peps
+      tmp9s.clear();
+      Contract(1.0,Li_d,shape(1),(*this)(Ly-1,col+1),shape(0),0.0,tmp9s);
 
-         //add to tmp8bis
-         tmp7.clear();
-         Contract(1.0,tmp8,shape(0,3,5),peps_op,shape(0,1,2),0.0,tmp7);
+      //-- ldru diagonal --
+      contractions::apply_stack(ham.gR_nn(),(*this)(Ly-1,col+1),peps_op);
 
-         //finally contract with bottom environment
-         tmp5.clear();
-         Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[col+1],shape(0,1,2),0.0,tmp5);
+      tmp7.clear();
+      Contract(1.0,tmp9s,shape(0,1,5,6),peps_op,shape(0,1,2,3),0.0,tmp7);
 
-         //lurd diagonal energy contribution
-         val += ham.gcoef_nn(i) * Dot(tmp5,R[col+1]);
+      tmp8.clear();
+      Contract(1.0,tmp7,shape(0,3),(*this)(Ly-2,col+1),shape(0,1),0.0,tmp8);
 
-      }
- 
-      //the nleft down
-      
-      //add top peps to left
-      for(int i = 0;i < delta;++i){
+      tmp7.clear();
+      Contract(1.0,tmp8,shape(0,3,5),(*this)(Ly-2,col+1),shape(0,1,2),0.0,tmp7);
+
+      tmp5.clear();
+      Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[col+1],shape(0,1,2),0.0,tmp5);
 
-         //-- ldru diagonal --
-         tmp8.clear();
-         Contract(1.0,Li_d[i],shape(0),(*this)(Ly-1,col+1),shape(0),0.0,tmp8);
+      //ldru-diagonal energy contribution
+      val += Dot(tmp5,R[col+1]);
 
-         //add operator to upper peps
-         peps_op.clear();
-         Contract(1.0,ham.gR(i),shape(j,k),(*this)(Ly-1,col+1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+      //-- bottom row horizontal --
+      tmp8s.clear();
+      Contract(1.0,tmp9s,shape(1,5,6),(*this)(Ly-1,col+1),shape(0,1,2),0.0,tmp8s);
 
-         //add to tmp8
-         tmp7.clear();
-         Contract(1.0,tmp8,shape(0,4,5),peps_op,shape(0,1,2),0.0,tmp7);
+      tmp9sbis.clear();
+      Contract(1.0,tmp8s,shape(1,4),(*this)(Ly-2,col+1),shape(0,1),0.0,tmp9sbis);
+
+      contractions::apply_stack(ham.gR_n(),(*this)(Ly-2,col+1),peps_op);
+
+      tmp7.clear();
+      Contract(1.0,tmp9sbis,shape(0,1,4,6),peps_op,shape(0,1,2,3),0.0,tmp7);
 
-         //add regular peps
-         tmp8bis.clear();
-         Contract(1.0,tmp7,shape(0,3),(*this)(Ly-2,col+1),shape(0,1),0.0,tmp8bis);
+      tmp5.clear();
+      Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[col+1],shape(0,1,2),0.0,tmp5);
 
-         //add another regular lower peps to tmp8bis
-         tmp7.clear();
-         Contract(1.0,tmp8bis,shape(0,3,5),(*this)(Ly-2,col+1),shape(0,1,2),0.0,tmp7);
+      //bottom row horizontal energy contribution
+      val += Dot(tmp5,R[col+1]);
 
-         //finally contract with bottom environment
-         tmp5.clear();
-         Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[col+1],shape(0,1,2),0.0,tmp5);
+   }
 
-         //ldru-diagonal energy contribution
-         val += ham.gcoef_nn(i) * Dot(tmp5,R[col+1]);
+   //last row vertical update
+   tmp8.clear();
+   Contract(1.0,L,shape(0),(*this)(Ly-1,Lx-1),shape(0),0.0,tmp8);
 
-         //bottom row horizontal
+   contractions::apply_stack(ham.gL_stack(),(*this)(Ly-1,Lx-1),peps_op);
+   contractions::open_stack(tmp8,shape(0,4,5),peps_op,tmp8s);
 
-         //add regular upper peps to tmp8
-         tmp7.clear();
-         Contract(1.0,tmp8,shape(0,4,5),(*this)(Ly-1,col+1),shape(0,1,2),0.0,tmp7);
+   tmp9s.clear();
+   Contract(1.0,tmp8s,shape(1,4),(*this)(Ly-2,Lx-1),shape(0,1),0.0,tmp9s);
 
-         //add regular lower peps
-         tmp8.clear();
-         Contract(1.0,tmp7,shape(0,3),(*this)(Ly-2,col+1),shape(0,1),0.0,tmp8);
+   contractions::apply_stack(ham.gR_n(),(*this)(Ly-2,Lx-1),peps_op);
 
-         //add operator to lower peps
-         peps_op.clear();
-         Contract(1.0,ham.gR(i),shape(j,k),(*this)(Ly-2,col+1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+   tmp7.clear();
+   Contract(1.0,tmp9s,shape(0,1,4,6),peps_op,shape(0,1,2,3),0.0,tmp7);
 
-         //add to tmp8bis
-         tmp7.clear();
-         Contract(1.0,tmp8,shape(0,3,5),peps_op,shape(0,1,2),0.0,tmp7);
+   tmp5.clear();
+   Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[Lx-1],shape(0,1,2),0.0,tmp5);
 
-         //finally contract with bottom environment
-         tmp5.clear();
-         Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[col+1],shape(0,1,2),0.0,tmp5);
+   //vertical energy
+   val += Dot(tmp5,R[Lx-1]);
+
+   return val;
+
+}
+
+/**
+ * evaluate the expectation value of the energy for the nn-Heisenberg model
+ * beware, the environments have to be constructed beforehand!
+ * The contributions of the row pairs only depend on the environment layers around them and are evaluated as concurrent OpenMP tasks.
+ * When the layers are kept out-of-core the tasks run one after the other, since loading layers is not thread safe.
+ */
+template<>
+double PEPS<double>::energy(){
 
-         //bottom row horizontal energy contribution
-         val += ham.gcoef_n(i) * Dot(tmp5,R[col+1]);
+   //contribution of every row pair: bottom pair, middle pairs (row,row+1) and top pair
+   vector<double> part(Ly - 1,0.0);
+
+#pragma omp parallel if(env.gstore().gcapacity() == 0)
+#pragma omp single
+   {
+
+#pragma omp task shared(part)
+      {
+
+         vector< DArray<5> > R(Lx);
+         contractions::init_ro('b',*this,R);
+
+         part[0] = this->energy_bottom(R);
 
       }
 
-   }
+      for(int row = 1;row < Ly - 2;++row){
 
-   //last row vertical update
+#pragma omp task shared(part) firstprivate(row)
+         {
 
-   //add top peps to left
-   tmp8.clear();
-   Contract(1.0,L,shape(0),(*this)(Ly-1,Lx-1),shape(0),0.0,tmp8);
+            FOOTPRINT_TAG("energy_row");
 
-   //construct Left Up operator first
-   for(int i = 0;i < delta;++i){
+            vector< DArray<6> > RO(Lx);
+            contractions::init_ro(row,*this,RO);
 
-      //add operator to upper peps
-      peps_op.clear();
-      Contract(1.0,ham.gL(i),shape(j,k),(*this)(Ly-1,Lx-1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+            part[row] = this->energy_row(row,RO);
 
-      //add to tmp8
-      tmp7.clear();
-      Contract(1.0,tmp8,shape(0,4,5),peps_op,shape(0,1,2),0.0,tmp7);
+         }
 
-      //add regular peps
-      tmp8bis.clear();
-      Contract(1.0,tmp7,shape(0,3),(*this)(Ly-2,Lx-1),shape(0,1),0.0,tmp8bis);
+      }
 
-      //right operator to lower peps
-      peps_op.clear();
-      Contract(1.0,ham.gR(i),shape(j,k),(*this)(Ly-2,Lx-1),shape(l,m,k,n,o),0.0,peps_op,shape(l,m,j,n,o));
+#pragma omp task shared(part)
+      {
 
-      //add to tmp8bis
-      tmp7.clear();
-      Contract(1.0,tmp8bis,shape(0,3,5),peps_op,shape(0,1,2),0.0,tmp7);
+         vector< DArray<5> > R(Lx);
+         contractions::init_ro('t',*this,R);
 
-      //finally contract with bottom environment
-      tmp5.clear();
-      Contract(1.0,tmp7,shape(0,3,5),env.gb(Ly-3)[Lx-1],shape(0,1,2),0.0,tmp5);
+         part[Ly - 2] = this->energy_top(R);
 
-      //vertical energy
-      val += ham.gcoef_n(i) * Dot(tmp5,R[Lx-1]);
+      }
 
    }
 
+   //fixed order of summation: the result does not depend on the nr of threads
+   double val = 0.0;
+
+   for(int i = 0;i < Ly - 1;++i)
+      val += part[i];
+
    return val;
 
 }
@@ -1557,6 +1695,65 @@ void PEPS<T>::canonicalize(int row,const BTAS_SIDE &dir,bool norm){
 
    }
 
+   this->touch(row);
+
+}
+
+/**
+ * mark a row as changed: environment layers constructed from the old tensors on this row become out of date
+ * @param row the row index
+ */
+template<typename T>
+void PEPS<T>::touch(int row){
+
+   if(version.size() != Ly)
+      version.resize(Ly);
+
+   version[row] = ++version_counter;
+
+}
+
+/**
+ * mark all the rows as changed
+ */
+template<typename T>
+void PEPS<T>::touch(){
+
+   for(int row = 0;row < Ly;++row)
+      this->touch(row);
+
+}
+
+/**
+ * @param row the row index
+ * @return the version stamp of row 'row'
+ */
+template<typename T>
+unsigned long PEPS<T>::gversion(int row) const {
+
+   return version[row];
+
+}
+
+/**
+ * @return the log of the norm which has been divided out of the tensors by rescale_tensors, normalize and the normalization of the strips
+ * in propagate::step: the state which is evolved is exp(log_norm) times the contraction of the tensors
+ */
+template<typename T>
+double PEPS<T>::glog_norm() const {
+
+   return log_norm;
+
+}
+
+/**
+ * @param log_norm_in new value of the log of the norm divided out of the tensors
+ */
+template<typename T>
+void PEPS<T>::slog_norm(double log_norm_in){
+
+   log_norm = log_norm_in;
+
 }
 
 //forward declarations for types to be used!
@@ -1569,6 +1766,9 @@ template PEPS< complex<double> >::PEPS(int);
 template PEPS<double>::PEPS(const PEPS<double> &);
 template PEPS< complex<double> >::PEPS(const PEPS< complex<double> > &);
 
+template PEPS<double> &PEPS<double>::operator=(const PEPS<double> &);
+template PEPS< complex<double> > &PEPS< complex<double> >::operator=(const PEPS< complex<double> > &);
+
 template PEPS<double>::~PEPS();
 template PEPS< complex<double> >::~PEPS();
 
@@ -1596,5 +1796,29 @@ template void PEPS< complex<double> >::fill_Random();
 template void PEPS<double>::save(const char *filename);
 template void PEPS< complex<double> >::save(const char *filename);
 
+template void PEPS<double>::load_txt(const char *filename);
+template void PEPS< complex<double> >::load_txt(const char *filename);
+
+template void PEPS<double>::serialize(vector<char> &) const;
+template void PEPS< complex<double> >::serialize(vector<char> &) const;
+
+template size_t PEPS<double>::deserialize(const char *,size_t);
+template size_t PEPS< complex<double> >::deserialize(const char *,size_t);
+
 template void PEPS<double>::canonicalize(int row,const BTAS_SIDE &dir,bool norm);
 template void PEPS< complex<double> >::canonicalize(int row,const BTAS_SIDE &dir,bool norm);
+
+template void PEPS<double>::touch(int);
+template void PEPS< complex<double> >::touch(int);
+
+template void PEPS<double>::touch();
+template void PEPS< complex<double> >::touch();
+
+template unsigned long PEPS<double>::gversion(int) const;
+template unsigned long PEPS< complex<double> >::gversion(int) const;
+
+template double PEPS<double>::glog_norm() const;
+template double PEPS< complex<double> >::glog_norm() const;
+
+template void PEPS<double>::slog_norm(double);
+template void PEPS< complex<double> >::slog_norm(double);
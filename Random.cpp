@@ -73,3 +73,51 @@ double Random::normal(){
    return (*gauss[tid])(mersenne[tid]);
 
 }
+
+void Random::seed(unsigned long value){
+
+   for (int cnt=0; cnt<num_omp_threads; cnt++){
+
+      mersenne[cnt].seed( value + cnt*cnt*23 );
+
+      dists[cnt]->reset();
+      gauss[cnt]->reset();
+
+   }
+
+}
+
+void Random::save(std::ostream &out) const {
+
+   out << num_omp_threads << endl;
+
+   for (int cnt=0; cnt<num_omp_threads; cnt++)
+      out << mersenne[cnt] << endl << *dists[cnt] << endl << *gauss[cnt] << endl;
+
+}
+
+void Random::load(std::istream &in){
+
+   int num;
+   in >> num;
+
+   //a different nr of threads: only the streams which exist in both are restored
+   for (int cnt=0; cnt<num; cnt++){
+
+      boost::random::mt19937 engine;
+      boost::random::uniform_real_distribution<double> dist;
+      boost::random::normal_distribution<double> norm;
+
+      in >> engine >> dist >> norm;
+
+      if(cnt < num_omp_threads){
+
+         mersenne[cnt] = engine;
+         *dists[cnt] = dist;
+         *gauss[cnt] = norm;
+
+      }
+
+   }
+
+}
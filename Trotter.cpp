@@ -3,6 +3,7 @@
 #include <cmath>
 #include <vector>
 #include <complex>
+#include <stdexcept>
 
 using std::cout;
 using std::endl;
@@ -23,10 +24,12 @@ Trotter::Trotter() { }
 /** 
  * constructor
  * @param tau timestep
+ * @param tol_in singular values of the gates below tol_in times the largest one are dropped when they are split, see split
  */
-Trotter::Trotter(double tau_in) {
+Trotter::Trotter(double tau_in,double tol_in) {
 
    this->tau = tau_in;
+   this->tol = tol_in;
 
    //nearest neigbour
 
@@ -80,39 +83,8 @@ Trotter::Trotter(double tau_in) {
    tmp(1,2) = ts_gate(1,2);
    tmp(2,1) = ts_gate(2,1);
 
-   DArray<2> U(d*d,d*d);
-   DArray<2> V(d*d,d*d);
+   error_n = this->split(tmp,LO_n,RO_n,LO_n_nz,RO_n_nz);
 
-   //now svd of tmp
-   Gesvd('S','S',tmp,eig,U,V);
-
-   int dim = 0;
-
-   for(int i = 0;i < d*d;++i)
-      if( fabs(eig(i)) > 1.0e-15)
-         dim++;
-
-   //now put them correctly into left and right operators
-   this->LO_n.resize(d,dim,d);
-   this->RO_n.resize(d,dim,d);
-
-   this->LO_n = 0.0;
-   this->RO_n = 0.0;
-
-   for(int s = 0;s < d;++s)
-      for(int s_ = 0;s_ < d;++s_){
-
-         int i = s*d + s_;
-
-         for(int k = 0;k < dim;++k){
-
-            this->LO_n(s,k,s_) = U(i,k) * sqrt( eig(k) );
-            this->RO_n(s,k,s_) = sqrt( eig(k) ) * V(k,i);
-
-         }
-
-      }
-   
    //next-nearest neigbour
 
    //first construct S_i.S_j on a d^2 x d^2 space
@@ -158,36 +130,150 @@ Trotter::Trotter(double tau_in) {
    tmp(1,2) = ts_gate(1,2);
    tmp(2,1) = ts_gate(2,1);
 
-   //now svd of tmp
-   Gesvd('S','S',tmp,eig,U,V);
+   error_nn = this->split(tmp,LO_nn,RO_nn,LO_nn_nz,RO_nn_nz);
 
-   dim = 0;
+}
 
-   for(int i = 0;i < d*d;++i)
-      if( fabs(eig(i)) > 1.0e-15)
-         dim++;
+/**
+ * split a two-site gate into a left and a right operator LO and RO, of shape (d,dim,d), such that the gate is the sum over k of
+ * LO(:,k,:) x RO(:,k,:). The gates conserve the total Sz: in the |s><s'| x |t><t'| form the spin changed on one site is changed back on
+ * the other, s' - s = t - t'. So the svd is done for every change of spin q = s' - s separately, and every k of LO and RO changes the spin
+ * by a fixed amount: LO(:,k,:) and RO(:,k,:) have at most d nonzero elements, which are listed in LO_nz and RO_nz. Singular values below
+ * tol times the largest one are dropped, which lowers dim at the cost of an error in the gate. A multiplet of degenerate singular values is
+ * kept or dropped as a whole, so the truncated gate keeps the spin symmetry: for the Heisenberg gates, with one large singular value and a
+ * triplet, this leaves rank 4 or 1. Rank 1 is a product of one site operators which cannot entangle the sites, and is refused.
+ * @param tmp the gate in the |s><s'| x |t><t'| form, elements which change the total spin are ignored
+ * @param LO left operator, output
+ * @param RO right operator, output
+ * @param LO_nz nonzero elements of LO, output
+ * @param RO_nz nonzero elements of RO, output
+ * @return the error of the split: the norm of the dropped singular values relative to the norm of all of them
+ */
+double Trotter::split(const DArray<2> &tmp,DArray<3> &LO,DArray<3> &RO,vector<Element> &LO_nz,vector<Element> &RO_nz) const {
 
-   //now put them correctly into left and right operators
-   this->LO_nn.resize(d,dim,d);
-   this->RO_nn.resize(d,dim,d);
+   //the decomposition of every change of spin q, from -(d - 1) to d - 1
+   vector< DArray<1> > sigma(2*d - 1);
+   vector< DArray<2> > U(2*d - 1);
+   vector< DArray<2> > V(2*d - 1);
 
-   this->LO_nn = 0.0;
-   this->RO_nn = 0.0;
+   //the elements |s><s'| of the left site with s' - s = q, and |t><t'| of the right site with t - t' = q
+   vector< vector<int> > rows(2*d - 1);
+   vector< vector<int> > cols(2*d - 1);
 
    for(int s = 0;s < d;++s)
       for(int s_ = 0;s_ < d;++s_){
 
-         int i = s*d + s_;
+         rows[s_ - s + d - 1].push_back(s*d + s_);
+         cols[s - s_ + d - 1].push_back(s*d + s_);
 
-         for(int k = 0;k < dim;++k){
+      }
 
-            this->LO_nn(s,k,s_) = U(i,k) * sqrt( eig(k) );
-            this->RO_nn(s,k,s_) = sqrt( eig(k) ) * V(k,i);
+   double max = 0.0;
+   double total = 0.0;
 
-         }
+   for(int q = 0;q < 2*d - 1;++q){
+
+      DArray<2> block(rows[q].size(),cols[q].size());
+
+      for(int r = 0;r < rows[q].size();++r)
+         for(int c = 0;c < cols[q].size();++c)
+            block(r,c) = tmp(rows[q][r],cols[q][c]);
+
+      Gesvd('S','S',block,sigma[q],U[q],V[q]);
+
+      for(int k = 0;k < sigma[q].size();++k){
+
+         max = std::max(max,sigma[q](k));
+         total += sigma[q](k) * sigma[q](k);
 
       }
 
+   }
+
+   //lower the cut below the smallest singular value which is kept, so that the values degenerate with it are kept as well
+   double cut = tol * max;
+   double low = max;
+
+   for(int q = 0;q < 2*d - 1;++q)
+      for(int k = 0;k < sigma[q].size();++k)
+         if(sigma[q](k) > cut)
+            low = std::min(low,sigma[q](k));
+
+   cut = std::min(cut,low - 1.0e-10 * max);
+
+   //the singular values which are kept
+   int dim = 0;
+   int nonzero = 0;
+
+   double dropped = 0.0;
+
+   for(int q = 0;q < 2*d - 1;++q)
+      for(int k = 0;k < sigma[q].size();++k){
+
+         if(sigma[q](k) > 1.0e-15)
+            nonzero++;
+
+         if(sigma[q](k) > cut && sigma[q](k) > 1.0e-15)
+            dim++;
+         else
+            dropped += sigma[q](k) * sigma[q](k);
+
+      }
+
+   //not BTAS_THROW: this has to be checked in optimized builds as well
+   if(dim == 1 && nonzero > 1)
+      throw std::runtime_error("Trotter::split: the tolerance leaves a gate of rank 1, a product operator which cannot entangle the sites");
+
+   LO.resize(d,dim,d);
+   RO.resize(d,dim,d);
+
+   LO = 0.0;
+   RO = 0.0;
+
+   int kk = 0;
+
+   for(int q = 0;q < 2*d - 1;++q)
+      for(int k = 0;k < sigma[q].size();++k){
+
+         if(!(sigma[q](k) > cut && sigma[q](k) > 1.0e-15))
+            continue;
+
+         for(int r = 0;r < rows[q].size();++r)
+            LO(rows[q][r] / d,kk,rows[q][r] % d) = U[q](r,k) * sqrt( sigma[q](k) );
+
+         for(int c = 0;c < cols[q].size();++c)
+            RO(cols[q][c] / d,kk,cols[q][c] % d) = sqrt( sigma[q](k) ) * V[q](k,c);
+
+         ++kk;
+
+      }
+
+   //the nonzero elements
+   LO_nz.clear();
+   RO_nz.clear();
+
+   for(int s = 0;s < d;++s)
+      for(int k = 0;k < dim;++k)
+         for(int s_ = 0;s_ < d;++s_){
+
+            if(LO(s,k,s_) != 0.0){
+
+               Element el = { s, k, s_, LO(s,k,s_) };
+               LO_nz.push_back(el);
+
+            }
+
+            if(RO(s,k,s_) != 0.0){
+
+               Element el = { s, k, s_, RO(s,k,s_) };
+               RO_nz.push_back(el);
+
+            }
+
+         }
+
+   return (total > 0.0) ? sqrt(dropped / total) : 0.0;
+
 }
 
 /** 
@@ -197,6 +283,7 @@ Trotter::Trotter(double tau_in) {
 Trotter::Trotter(const Trotter &trotter_c){
 
    tau = trotter_c.gtau();
+   tol = trotter_c.gtol();
 
    LO_n = trotter_c.gLO_n();
    RO_n = trotter_c.gRO_n();
@@ -204,6 +291,15 @@ Trotter::Trotter(const Trotter &trotter_c){
    LO_nn = trotter_c.gLO_nn();
    RO_nn = trotter_c.gRO_nn();
 
+   LO_n_nz = trotter_c.gLO_n_nz();
+   RO_n_nz = trotter_c.gRO_n_nz();
+
+   LO_nn_nz = trotter_c.gLO_nn_nz();
+   RO_nn_nz = trotter_c.gRO_nn_nz();
+
+   error_n = trotter_c.gerror_n();
+   error_nn = trotter_c.gerror_nn();
+
 }
 
 /**
@@ -220,6 +316,15 @@ double Trotter::gtau() const {
 
 }
 
+/**
+ * @return the tolerance on the singular values of the split gates
+ */
+double Trotter::gtol() const {
+
+   return tol;
+
+}
+
 /**
  * @return the left trotter operator for nearest neigbour gates
  */
@@ -255,3 +360,57 @@ const DArray<3> &Trotter::gRO_nn() const {
    return RO_nn;
 
 }
+
+/**
+ * @return the nonzero elements of the left trotter operator for nearest neigbour gates
+ */
+const vector<Trotter::Element> &Trotter::gLO_n_nz() const {
+
+   return LO_n_nz;
+
+}
+
+/**
+ * @return the nonzero elements of the right trotter operator for nearest neigbour gates
+ */
+const vector<Trotter::Element> &Trotter::gRO_n_nz() const {
+
+   return RO_n_nz;
+
+}
+
+/**
+ * @return the nonzero elements of the left trotter operator for next nearest neigbour gates
+ */
+const vector<Trotter::Element> &Trotter::gLO_nn_nz() const {
+
+   return LO_nn_nz;
+
+}
+
+/**
+ * @return the nonzero elements of the right trotter operator for next nearest neigbour gates
+ */
+const vector<Trotter::Element> &Trotter::gRO_nn_nz() const {
+
+   return RO_nn_nz;
+
+}
+
+/**
+ * @return the relative error of the split of the nearest neigbour gate, 0 unless singular values were dropped
+ */
+double Trotter::gerror_n() const {
+
+   return error_n;
+
+}
+
+/**
+ * @return the relative error of the split of the next nearest neigbour gate, 0 unless singular values were dropped
+ */
+double Trotter::gerror_nn() const {
+
+   return error_nn;
+
+}
@@ -0,0 +1,273 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <chrono>
+#include <cmath>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+#include "include.h"
+
+namespace batch {
+
+   /**
+    * read a job file: one job per line "L d D D_aux J2 noise tau steps output", empty lines and lines starting with '#' are skipped
+    * @param filename name of the job file
+    * @return the jobs, in the order of the file
+    */
+   vector<Job> read(const std::string &filename){
+
+      std::ifstream in(filename.c_str());
+
+      //not BTAS_THROW: this has to be checked in optimized builds as well
+      if(!in)
+         throw std::runtime_error("batch::read: could not open " + filename);
+
+      vector<Job> jobs;
+
+      std::string line;
+
+      while(std::getline(in,line)){
+
+         std::istringstream fields(line);
+
+         std::string first;
+
+         if(!(fields >> first) || first[0] == '#')
+            continue;
+
+         Job job;
+
+         job.L = atoi(first.c_str());
+
+         if(!(fields >> job.d >> job.D >> job.D_aux >> job.J2 >> job.noise >> job.tau >> job.steps >> job.output))
+            throw std::runtime_error("batch::read: line '" + line + "' of " + filename + " is not of the form L d D D_aux J2 noise tau steps output");
+
+         jobs.push_back(job);
+
+      }
+
+      return jobs;
+
+   }
+
+   /**
+    * run a single job in this process: the global state is initialized for its parameter point and the Jastrow state is grown to D the way a
+    * ramp of main does it: two steps at the dimension of the Jastrow state set the energy window in which schedule::grow accepts the padding
+    * with relative noise, after which the state is evolved for the nr of steps of the job. The energy of every step is written to the output
+    * file of the job
+    * @param job the job
+    */
+   void run(const Job &job){
+
+      global::init(job.D,job.D_aux,job.d,job.L,job.L,job.J2,job.tau,job.noise);
+
+      std::ofstream out(job.output.c_str());
+
+      if(!out)
+         throw std::runtime_error("batch::run: could not open " + job.output);
+
+      out.precision(15);
+
+      PEPS<double> peps(job.D);
+
+      peps.initialize_jastrow(0.74);
+
+      vector<schedule::Stage> stages;
+
+      if(job.D > peps.gD()){
+
+         global::sD(peps.gD());
+
+         schedule::Stage start = { peps.gD(), job.D_aux, 1.0e-5, 2 };
+         stages.push_back(start);
+
+      }
+
+      peps.normalize();
+
+      peps.rescale_tensors(global::scal_num);
+      peps.normalize();
+
+      //never converged: all the steps of the job are done
+      schedule::Stage stage = { job.D, job.D_aux, 0.0, job.steps };
+      stages.push_back(stage);
+
+      vector<double> energy;
+      schedule::ramp(peps,stages,1.0e-3,'F',1,energy);
+
+      for(int i = 0;i < energy.size();++i)
+         out << i << "\t" << energy[i] << endl;
+
+   }
+
+   /**
+    * run the jobs in forked workers, at most 'slots' at the same time. The cores this process may run on are split in 'slots' equal parts:
+    * a worker is pinned to the part of the slot it runs in and uses as many OpenMP (and threaded BLAS) threads as that part has cores, so the
+    * workers do not compete for the same cores. Every worker has its own copy of the global state, which makes it a separate simulation context.
+    * Nothing may have started an OpenMP thread pool in this process before the workers are forked.
+    * @param jobs the jobs
+    * @param slots nr of jobs which run at the same time
+    * @return the result of every job
+    */
+   vector<Result> launch(const vector<Job> &jobs,int slots){
+
+      cpu_set_t allowed;
+      CPU_ZERO(&allowed);
+
+      if(sched_getaffinity(0,sizeof(allowed),&allowed) != 0)
+         throw std::runtime_error("batch::launch: could not get the cpu affinity");
+
+      vector<int> cores;
+
+      for(int c = 0;c < CPU_SETSIZE;++c)
+         if(CPU_ISSET(c,&allowed))
+            cores.push_back(c);
+
+      if(slots < 1)
+         slots = 1;
+
+      if(slots > cores.size())
+         slots = cores.size();
+
+      int threads = cores.size() / slots;
+
+      vector<Result> results(jobs.size());
+
+      //job and start of the job running in every slot, -1 if the slot is free
+      vector<pid_t> pid(slots,-1);
+      vector<int> running(slots,-1);
+      vector<std::chrono::steady_clock::time_point> start(slots);
+
+      int next = 0;
+      int busy = 0;
+
+      while(next < jobs.size() || busy > 0){
+
+         //fill the free slots
+         for(int s = 0;s < slots && next < jobs.size();++s){
+
+            if(pid[s] != -1)
+               continue;
+
+            start[s] = std::chrono::steady_clock::now();
+
+            pid_t child = fork();
+
+            if(child == -1)
+               throw std::runtime_error("batch::launch: fork failed");
+
+            if(child == 0){
+
+               cpu_set_t part;
+               CPU_ZERO(&part);
+
+               for(int c = s*threads;c < (s + 1)*threads;++c)
+                  CPU_SET(cores[c],&part);
+
+               sched_setaffinity(0,sizeof(part),&part);
+
+#ifdef _OPENMP
+               omp_set_num_threads(threads);
+#endif
+
+               int status = 0;
+
+               try {
+
+                  run(jobs[next]);
+
+               }
+               catch(const std::exception &e){
+
+                  std::cerr << "batch job " << next << ": " << e.what() << endl;
+                  status = 1;
+
+               }
+
+               //no exit handlers of the parent are run in the worker
+               _exit(status);
+
+            }
+
+            pid[s] = child;
+            running[s] = next;
+
+            ++next;
+            ++busy;
+
+         }
+
+         //wait for a worker to finish and free its slot
+         int status;
+         pid_t done = waitpid(-1,&status,0);
+
+         if(done == -1){
+
+            if(errno == EINTR)
+               continue;
+
+            throw std::runtime_error("batch::launch: waitpid failed");
+
+         }
+
+         for(int s = 0;s < slots;++s)
+            if(pid[s] == done){
+
+               Result &result = results[running[s]];
+
+               result.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+               result.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start[s]).count();
+
+               pid[s] = -1;
+               running[s] = -1;
+
+               --busy;
+
+            }
+
+      }
+
+      return results;
+
+   }
+
+   /**
+    * print the jobs with their results as a table
+    * @param out the stream to print to
+    * @param jobs the jobs
+    * @param results the results returned by launch
+    */
+   void print(ostream &out,const vector<Job> &jobs,const vector<Result> &results){
+
+      out << "#job\tL\tD\tD_aux\tJ2\ttau\tsteps\tstatus\ttime\toutput" << endl;
+
+      for(int i = 0;i < jobs.size();++i){
+
+         out << i << "\t" << jobs[i].L << "\t" << jobs[i].D << "\t" << jobs[i].D_aux << "\t" << jobs[i].J2 << "\t" << jobs[i].tau << "\t" << jobs[i].steps
+
+            << "\t" << results[i].status << "\t" << results[i].time << "\t" << jobs[i].output << endl;
+
+      }
+
+   }
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -0,0 +1,116 @@
+/**
+ * Benchmark of the column-blocked compression of the boundary 'MPO' layers (Environment::compress_blocks) against the serial sweeps
+ * of add_layer. For every nr of blocks the complete environment of the same state is calculated a few times, and the median time, the
+ * speedup and the deviation of the energy are printed, relative to the first nr of blocks of the list (1, the serial sweeps, by default).
+ * The blocks are swept by OpenMP threads, so the speedup is bounded by the nr of threads, which is printed with the results.
+ * usage: bench_blocks L d D D_aux J2 [list of nrs of blocks, default 1,2,4] [nr of repetitions, default 3]
+ */
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <chrono>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using std::cout;
+using std::endl;
+using std::vector;
+using std::complex;
+
+#include "include.h"
+
+using namespace btas;
+
+int main(int argc,char *argv[]){
+
+   cout.precision(10);
+
+   int L = atoi(argv[1]);//dimension of the lattice: LxL
+   int d = atoi(argv[2]);//physical dimension
+   int D = atoi(argv[3]);//virtual dimension
+   int D_aux = atoi(argv[4]);//auxiliary dimension
+   int J2 = atoi(argv[5]);
+
+   vector<int> blocks;
+
+   std::istringstream list((argc > 6) ? argv[6] : "1,2,4");
+   std::string item;
+
+   while(std::getline(list,item,','))
+      blocks.push_back(atoi(item.c_str()));
+
+   int reps = (argc > 7) ? atoi(argv[7]) : 3;
+
+   global::init(D,D_aux,d,L,L,J2,0.01,-10);
+
+   PEPS<double> peps(D);
+   peps.initialize_jastrow(0.74);
+
+   if(D > 1)
+      peps.grow_bond_dimension(D,0.01);
+
+   peps.normalize();
+
+   peps.rescale_tensors(global::scal_num);
+   peps.normalize();
+
+   int threads = 1;
+
+#ifdef _OPENMP
+   threads = omp_get_max_threads();
+#endif
+
+   cout << "#threads\t" << threads << endl;
+   cout << "blocks\tmedian time (s)\tspeedup\tenergy\t\tdeviation" << endl;
+
+   double ref_time = 0.0;
+   double ref_energy = 0.0;
+
+   for(int b = 0;b < blocks.size();++b){
+
+      vector<double> time(reps);
+
+      double E = 0.0;
+
+      for(int r = 0;r < reps;++r){
+
+         global::env = Environment(D,D_aux,global::comp_sweeps);
+         global::env.sblocks(blocks[b]);
+
+         std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+         global::env.calc('A',peps);
+
+         std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+
+         time[r] = std::chrono::duration_cast< std::chrono::duration<double> >(stop - start).count();
+
+         E = peps.energy();
+
+      }
+
+      std::sort(time.begin(),time.end());
+
+      double t = time[reps / 2];
+
+      if(b == 0){
+
+         ref_time = t;
+         ref_energy = E;
+
+      }
+
+      cout << blocks[b] << "\t" << std::setw(12) << t << "\t" << ref_time / t << "\t" << E << "\t" << std::fabs(E - ref_energy) << endl;
+
+   }
+
+   return 0;
+
+}
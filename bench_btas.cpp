@@ -0,0 +1,312 @@
+/**
+ * Microbenchmark of the btas kernels at the shapes in which they occur in a time step: the contractions and permutation of
+ * propagate::calc_N_eff, the compression sweep of Environment::add_layer and the left operator update of PEPS::energy, the svd
+ * of the initial guess (full) and of the layer truncation (thin), the QR and LQ decompositions of shift_col and of the layers,
+ * and the solve and diagonalization of the effective environment. The kernels are timed in isolation on random tensors, for
+ * every (D,D_aux) of the grid: latency percentiles, GFlop/s and GB/s (flops and bytes of the arguments per median call).
+ * usage: bench_btas [list of D, default 2,3] [list of D_aux, default 8,16] [minimal time per kernel in s, default 0.2]
+ */
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+
+using std::cout;
+using std::endl;
+using std::vector;
+using std::complex;
+using std::ofstream;
+
+#include "include.h"
+
+using namespace btas;
+
+/**
+ * read a comma separated list of integers
+ * @param str the list, e.g. "2,3,4"
+ * @return the integers
+ */
+vector<int> parse(const std::string &str){
+
+   vector<int> list;
+
+   std::istringstream in(str);
+   std::string item;
+
+   while(std::getline(in,item,','))
+      list.push_back(atoi(item.c_str()));
+
+   return list;
+
+}
+
+/**
+ * @return the shape of a tensor as "[d0,d1,...]"
+ */
+template<size_t N>
+std::string describe(const DArray<N> &A){
+
+   std::ostringstream out;
+
+   out << "[";
+
+   for(int i = 0;i < N;++i)
+      out << (i ? "," : "") << A.shape(i);
+
+   out << "]";
+
+   return out.str();
+
+}
+
+/**
+ * @return a tensor of shape 'shape' with random elements
+ */
+template<size_t N>
+DArray<N> random(const IVector<N> &shape){
+
+   DArray<N> A(shape);
+   A.generate(global::rgen<double>);
+
+   return A;
+
+}
+
+/**
+ * @return the flops of a contraction with operands of size a and b and result of size c: every element of c is an inner product of length sqrt(a*b/c)
+ */
+double contract_flops(double a,double b,double c){
+
+   return 2.0 * c * sqrt(a * b / c);
+
+}
+
+/**
+ * time a kernel: after a warm-up call, it is called at least 10 times and until min_time has passed, prepare is called before every call
+ * and not timed. One line with the latency percentiles and the throughput at the median latency is printed.
+ * @param D virtual dimension
+ * @param D_aux auxiliary dimension
+ * @param name name of the kernel
+ * @param shapes the shapes of the arguments
+ * @param flops nr of flops of a call
+ * @param bytes nr of bytes of the arguments of a call
+ * @param min_time minimal time spent in the kernel
+ * @param prepare called before every call, e.g. to restore an argument which is overwritten
+ * @param kernel the call
+ */
+void bench(int D,int D_aux,const std::string &name,const std::string &shapes,double flops,double bytes,double min_time,
+
+      std::function<void()> prepare,std::function<void()> kernel){
+
+   prepare();
+   kernel();
+
+   vector<double> latency;
+   double total = 0.0;
+
+   while(latency.size() < 10 || (total < min_time && latency.size() < 100000)){
+
+      prepare();
+
+      std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+      kernel();
+
+      std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+
+      double t = std::chrono::duration_cast< std::chrono::duration<double> >(stop - start).count();
+
+      latency.push_back(t);
+      total += t;
+
+   }
+
+   std::sort(latency.begin(),latency.end());
+
+   double p50 = latency[latency.size() / 2];
+   double p90 = latency[(latency.size() * 9) / 10];
+   double p99 = latency[(latency.size() * 99) / 100];
+
+   cout << D << "\t" << D_aux << "\t" << std::left << std::setw(22) << name << std::setw(64) << shapes << std::right << std::setw(8) << latency.size()
+
+      << std::setw(12) << 1.0e6 * p50 << std::setw(12) << 1.0e6 * p90 << std::setw(12) << 1.0e6 * p99
+
+      << std::setw(10) << 1.0e-9 * flops / p50 << std::setw(10) << 1.0e-9 * bytes / p50 << endl;
+
+}
+
+/**
+ * time a contraction C = A * B over the legs ca of A and cb of B, C is kept and returned so that chains of contractions get their real shapes
+ */
+template<size_t L,size_t M,size_t K>
+DArray<L+M-K-K> contract(int D,int D_aux,const std::string &name,const DArray<L> &A,const IVector<K> &ca,const DArray<M> &B,const IVector<K> &cb,double min_time){
+
+   DArray<L+M-K-K> C;
+   Contract(1.0,A,ca,B,cb,0.0,C);
+
+   double flops = contract_flops(A.size(),B.size(),C.size());
+   double bytes = sizeof(double) * (A.size() + B.size() + C.size());
+
+   bench(D,D_aux,name,describe(A) + describe(B) + " -> " + describe(C),flops,bytes,min_time,
+
+         [&C](){ C.clear(); },[&](){ Contract(1.0,A,ca,B,cb,0.0,C); });
+
+   return C;
+
+}
+
+int main(int argc,char *argv[]){
+
+   cout.precision(3);
+   cout << std::fixed;
+
+   vector<int> D_list = parse((argc > 1) ? argv[1] : "2,3");
+   vector<int> D_aux_list = parse((argc > 2) ? argv[2] : "8,16");
+
+   double min_time = (argc > 3) ? atof(argv[3]) : 0.2;
+
+   int d = 2;
+
+   cout << "#D\tD_aux\t" << std::left << std::setw(22) << "kernel" << std::setw(64) << "shapes" << std::right << std::setw(8) << "calls"
+
+      << std::setw(12) << "p50 (us)" << std::setw(12) << "p90 (us)" << std::setw(12) << "p99 (us)" << std::setw(10) << "GFlop/s" << std::setw(10) << "GB/s" << endl;
+
+   for(int a = 0;a < D_list.size();++a)
+      for(int b = 0;b < D_aux_list.size();++b){
+
+         int D = D_list[a];
+         int X = D_aux_list[b];
+
+         //propagate::solve needs global::d
+         global::init(D,X,d,4,4,5,0.01,-10);
+
+         //a middle site, and a site of a boundary layer
+         DArray<5> site = random(shape(D,D,d,D,D));
+         DArray<4> layer = random(shape(X,D,D,X));
+
+         // --- propagate::calc_N_eff, vertical gate on a middle row, bottom site: LI8 and RI8 as made by construct_intermediate ---
+         DArray<8> LI8 = random(shape(X,D,D,D,D,D,D,X));
+         DArray<8> RI8 = random(shape(X,D,D,D,D,D,D,X));
+
+         DArray<9> tmp9 = contract(D,X,"N_eff LI8*site",LI8,shape(4,2),site,shape(0,1),min_time);
+         DArray<8> tmp8 = contract(D,X,"N_eff tmp9*site",tmp9,shape(2,1,6),site,shape(0,1,2),min_time);
+         DArray<8> tmp8bis = contract(D,X,"N_eff tmp8*RI8",tmp8,shape(0,7,5,3),RI8,shape(0,1,2,7),min_time);
+
+         DArray<8> N_eff;
+
+         bench(D,X,"N_eff Permute",describe(tmp8bis),0.0,2.0 * sizeof(double) * tmp8bis.size(),min_time,
+
+               [&N_eff](){ N_eff.clear(); },[&](){ Permute(tmp8bis,shape(0,3,6,4,1,2,7,5),N_eff); });
+
+         // --- Environment::add_layer, one step of the compression sweep: R * lower layer * site * site * new layer ---
+         DArray<4> R = random(shape(X,D,D,X));
+
+         DArray<6> tmp6 = contract(D,X,"add_layer R*layer",R,shape(0),layer,shape(0),min_time);
+         DArray<7> tmp7 = contract(D,X,"add_layer tmp6*site",tmp6,shape(0,3),site,shape(0,3),min_time);
+         DArray<6> tmp6bis = contract(D,X,"add_layer tmp7*site",tmp7,shape(0,2,5),site,shape(0,3,2),min_time);
+         contract(D,X,"add_layer tmp6*layer",tmp6bis,shape(0,2,4),layer,shape(0,1,2),min_time);
+
+         // --- PEPS::energy and propagate::step, left operator update of a middle row ---
+         DArray<6> LO = random(shape(X,D,D,D,D,X));
+
+         DArray<8> lo8 = contract(D,X,"update_L LO*layer",LO,shape(0),layer,shape(0),min_time);
+         DArray<9> lo9 = contract(D,X,"update_L tmp8*site",lo8,shape(0,5),site,shape(0,1),min_time);
+         contract(D,X,"update_L tmp9*site",lo9,shape(0,4,6),site,shape(0,1,2),min_time);
+
+         // --- svd: full, of the gate on two sites (propagate::initialize), and thin, of a layer to be truncated ---
+         DArray<8> gate = random(shape(D,d,D,D,D,D,d,D));
+
+         {
+            DArray<1> S;
+            DArray<5> U;
+            DArray<5> VT;
+
+            double m = D*D*D*d;
+
+            bench(D,X,"Gesvd full",describe(gate),22.0 * m * m * m,sizeof(double) * 3.0 * gate.size(),min_time,
+
+                  [](){},[&](){ Gesvd('A','A',gate,S,U,VT); });
+         }
+
+         DArray<6> wide = random(shape(X,D,D,D,D,X));
+
+         {
+            DArray<1> S;
+            DArray<4> U;
+            DArray<4> VT;
+
+            double m = X*D*D;
+
+            bench(D,X,"Gesvd thin",describe(wide),22.0 * m * m * m,sizeof(double) * 3.0 * wide.size(),min_time,
+
+                  [](){},[&](){ Gesvd('S','S',wide,S,U,VT); });
+         }
+
+         // --- QR and LQ: of a site in shift_col, and of a layer in the canonicalization of the boundary 'MPO' ---
+         {
+            DArray<5> A;
+            DArray<2> Rq;
+
+            double m = D*D*D*d;
+
+            bench(D,X,"Geqrf site",describe(site),4.0 * m * D * D - 4.0/3.0 * D * D * D,2.0 * sizeof(double) * site.size(),min_time,
+
+                  [&](){ A.clear(); Copy(site,A); },[&](){ Geqrf(A,Rq); });
+
+            bench(D,X,"Gelqf site",describe(site),4.0 * m * D * D - 4.0/3.0 * D * D * D,2.0 * sizeof(double) * site.size(),min_time,
+
+                  [&](){ A.clear(); Copy(site,A); },[&](){ Gelqf(Rq,A); });
+         }
+
+         {
+            DArray<4> A;
+            DArray<2> Rq;
+
+            double m = X*D*D;
+
+            bench(D,X,"Geqrf layer",describe(layer),4.0 * m * X * X - 4.0/3.0 * X * X * X,2.0 * sizeof(double) * layer.size(),min_time,
+
+                  [&](){ A.clear(); Copy(layer,A); },[&](){ Geqrf(A,Rq); });
+         }
+
+         // --- the linear system and the eigenvalues of the effective environment, N_eff made positive definite ---
+         {
+            int n = D*D*D*D;
+
+            DArray<2> Y = random(shape(n,n));
+            DArray<2> YYT;
+
+            Gemm(CblasNoTrans,CblasTrans,1.0,Y,Y,0.0,YYT);
+
+            for(int i = 0;i < n;++i)
+               YYT(i,i) += n;
+
+            DArray<8> N_ref = YYT.reshape_clear(shape(D,D,D,D,D,D,D,D));
+
+            DArray<5> rhs_ref = random(shape(D,D,D,D,d));
+
+            DArray<8> N;
+            DArray<5> rhs;
+            DArray<1> eig;
+
+            bench(D,X,"solve",describe(N_ref),n * (n / 3.0 + 2.0 * d) * n,sizeof(double) * (N_ref.size() + 2.0 * rhs_ref.size()),min_time,
+
+                  [&](){ N.clear(); Copy(N_ref,N); rhs.clear(); Copy(rhs_ref,rhs); },[&](){ propagate::solve(N,rhs); });
+
+            bench(D,X,"diagonalize",describe(N_ref),9.0 * n * n * n,2.0 * sizeof(double) * N_ref.size(),min_time,
+
+                  [&](){ N.clear(); Copy(N_ref,N); },[&](){ propagate::diagonalize(N,eig); });
+         }
+
+      }
+
+   return 0;
+
+}
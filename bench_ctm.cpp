@@ -0,0 +1,106 @@
+/**
+ * Benchmark of the environment contraction: time-to-accuracy of the energy for the variational boundary 'MPO' compression
+ * and for CTMRG at equal auxiliary dimension. The reference energy is calculated with boundary MPO's of dimension 2 * chi_max.
+ * usage: bench_ctm L d D chi_max J2 [nr of imaginary time steps]
+ */
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <chrono>
+
+using std::cout;
+using std::endl;
+using std::vector;
+using std::complex;
+using std::ofstream;
+
+#include "include.h"
+
+using namespace btas;
+
+/**
+ * construct a fresh environment, contract it for peps and evaluate the energy
+ * @param peps input PEPS<double>
+ * @param chi auxiliary dimension
+ * @param method 'M' boundary MPO compression or 'C' CTMRG
+ * @param max_iter maximal number of CTMRG iterations
+ * @param energy output: the energy
+ * @return the wall time in seconds
+ */
+double run(PEPS<double> &peps,int chi,char method,int max_iter,double &energy){
+
+   std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+   global::env = Environment(global::D,chi,global::comp_sweeps);
+   global::env.smethod(method);
+   global::env.gctm() = CTMRG(max_iter,0.0);
+
+   global::env.calc('A',peps);
+   energy = peps.energy();
+
+   std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+
+   return std::chrono::duration_cast< std::chrono::duration<double> >(stop - start).count();
+
+}
+
+int main(int argc,char *argv[]){
+
+   cout.precision(10);
+
+   int L = atoi(argv[1]);//dimension of the lattice: LxL
+   int d = atoi(argv[2]);//physical dimension
+   int D = atoi(argv[3]);//virtual dimension
+   int chi_max = atoi(argv[4]);//largest auxiliary dimension
+   int J2 = atoi(argv[5]);
+
+   int steps = (argc > 6) ? atoi(argv[6]) : 10;
+
+   global::init(D,2*chi_max,d,L,L,J2,0.01,-10);
+
+   PEPS<double> peps(D);
+   peps.initialize_jastrow(0.74);
+   peps.normalize();
+
+   peps.rescale_tensors(global::scal_num);
+   peps.normalize();
+
+   //make the state a bit less trivial
+   for(int i = 0;i < steps;++i){
+
+      propagate::step(peps,10);
+      peps.rescale_tensors(global::scal_num);
+      peps.normalize();
+
+   }
+
+   double E_ref;
+   double t_ref = run(peps,2*chi_max,'M',0,E_ref);
+
+   cout << "reference energy (chi = " << 2*chi_max << ")\t" << E_ref << "\t" << t_ref << " s" << endl;
+   cout << endl;
+   cout << "method\tchi\titer\ttime (s)\tenergy\t\t|dE|" << endl;
+
+   for(int chi = D*D;chi <= chi_max;chi *= 2){
+
+      double E;
+      double t = run(peps,chi,'M',0,E);
+
+      cout << "MPO\t" << chi << "\t-\t" << std::setw(10) << t << "\t" << E << "\t" << std::fabs(E - E_ref) << endl;
+
+      for(int iter = 1;iter <= 4;++iter){
+
+         t = run(peps,chi,'C',iter,E);
+
+         cout << "CTMRG\t" << chi << "\t" << iter << "\t" << std::setw(10) << t << "\t" << E << "\t" << std::fabs(E - E_ref) << endl;
+
+      }
+
+   }
+
+   return 0;
+
+}
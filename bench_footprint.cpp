@@ -0,0 +1,109 @@
+/**
+ * Benchmark of the memory planner: for a list of points (L,D,D_aux) the peak of the heap predicted by footprint::estimate is compared with
+ * the peak measured by the heap accounting over the same work as a time step of main: the Jastrow state padded to D, its environment from
+ * scratch, its energy and one imaginary time step. The measured peak is counted from the heap in use before the point starts, so it holds
+ * the PEPS, the layers and the largest transient, like the prediction. The prediction is made for the nr of OpenMP threads of the run.
+ * Only meaningful with the heap accounting compiled in: make bench DEFS=-D_FOOTPRINT
+ * usage: bench_footprint [list of points L:D:D_aux, default 6:2:8,6:3:9,8:2:8,8:3:9] [physical dimension, default 2] [J2, default 5]
+ */
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using std::cout;
+using std::endl;
+using std::vector;
+using std::complex;
+
+#include "include.h"
+
+using namespace btas;
+
+int main(int argc,char *argv[]){
+
+#ifndef _FOOTPRINT
+   std::cerr << "bench_footprint: the heap is not accounted, build with make bench DEFS=-D_FOOTPRINT" << endl;
+
+   return 1;
+#endif
+
+   cout.precision(10);
+
+   std::istringstream list((argc > 1) ? argv[1] : "6:2:8,6:3:9,8:2:8,8:3:9");
+
+   int d = (argc > 2) ? atoi(argv[2]) : 2;
+   int J2 = (argc > 3) ? atoi(argv[3]) : 5;
+
+   int threads = 1;
+
+#ifdef _OPENMP
+   threads = omp_get_max_threads();
+#endif
+
+   cout << "#threads\t" << threads << endl;
+   cout << "#L\tD\tD_aux\tpredicted (MB)\tmeasured (MB)\tratio" << endl;
+
+   std::string item;
+
+   while(std::getline(list,item,',')){
+
+      int L,D,D_aux;
+      char colon;
+
+      std::istringstream fields(item);
+
+      //not BTAS_THROW: this has to be checked in optimized builds as well
+      if(!(fields >> L >> colon >> D >> colon >> D_aux))
+         throw std::runtime_error("bench_footprint: point '" + item + "' is not of the form L:D:D_aux");
+
+      //the layers of the previous point are freed before the heap in use is taken as the baseline
+      global::env = Environment();
+
+      double base = footprint::current();
+      footprint::reset_peak();
+
+      global::init(D,D_aux,d,L,L,J2,0.01,-10);
+
+      {
+
+         PEPS<double> peps(D);
+         peps.initialize_jastrow(0.74);
+
+         if(D > peps.gD())
+            peps.grow_bond_dimension(D,0.01);
+
+         peps.normalize();
+
+         peps.rescale_tensors(global::scal_num);
+         peps.normalize();
+
+         global::env.calc('A',peps);
+
+         peps.energy();
+
+         propagate::step(peps,10);
+
+      }
+
+      double measured = footprint::peak() - base;
+
+      footprint::Plan plan = footprint::estimate(L,L,d,D,D_aux,threads,global::env.gblocks(),global::env.gstore().gcapacity());
+
+      cout << L << "\t" << D << "\t" << D_aux << "\t" << std::setw(12) << 1.0e-6 * plan.peak << "\t" << std::setw(12) << 1.0e-6 * measured
+
+         << "\t" << plan.peak / measured << endl;
+
+   }
+
+   return 0;
+
+}
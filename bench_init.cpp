@@ -0,0 +1,84 @@
+/**
+ * Benchmark of the initial guess for the variational compression of the boundary 'MPO' layers: truncated svd's ('S'),
+ * zip-up with randomized QR projections ('Z') and the layer of the previous step ('P'). For every initializer the same
+ * imaginary time evolution is run, and the time spent in the initialization, the average fidelity of the initial guesses
+ * with the compressed layers and the final energy are printed.
+ * usage: bench_init L d D D_aux J2 [nr of imaginary time steps]
+ */
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <chrono>
+
+using std::cout;
+using std::endl;
+using std::vector;
+using std::complex;
+using std::ofstream;
+
+#include "include.h"
+
+using namespace btas;
+
+int main(int argc,char *argv[]){
+
+   cout.precision(10);
+
+   int L = atoi(argv[1]);//dimension of the lattice: LxL
+   int d = atoi(argv[2]);//physical dimension
+   int D = atoi(argv[3]);//virtual dimension
+   int D_aux = atoi(argv[4]);//auxiliary dimension
+   int J2 = atoi(argv[5]);
+
+   int steps = (argc > 6) ? atoi(argv[6]) : 5;
+
+   global::init(D,D_aux,d,L,L,J2,0.01,-10);
+
+   PEPS<double> peps_0(D);
+   peps_0.initialize_jastrow(0.74);
+   peps_0.normalize();
+
+   peps_0.rescale_tensors(global::scal_num);
+   peps_0.normalize();
+
+   const char init[3] = {'S','Z','P'};
+
+   cout << "init\tlayers\tinit time (s)\ttotal time (s)\tfidelity\tenergy" << endl;
+
+   for(int i = 0;i < 3;++i){
+
+      PEPS<double> peps(peps_0);
+
+      global::env = Environment(D,D_aux,global::comp_sweeps);
+      global::env.sinit(init[i]);
+      global::env.sfidelity(true);
+
+      std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+      for(int s = 0;s < steps;++s){
+
+         propagate::step(peps,10);
+         peps.rescale_tensors(global::scal_num);
+         peps.normalize();
+
+      }
+
+      global::env.update('A',peps);
+      double E = peps.energy();
+
+      std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+
+      double t = std::chrono::duration_cast< std::chrono::duration<double> >(stop - start).count();
+
+      cout << init[i] << "\t" << global::env.ginit_count() << "\t" << std::setw(10) << global::env.ginit_time() << "\t" << std::setw(10) << t
+      
+         << "\t" << global::env.ginit_fidelity() << "\t" << E << endl;
+
+   }
+
+   return 0;
+
+}
@@ -0,0 +1,240 @@
+/**
+ * End-to-end regression benchmark: for a set of (L,D,D_aux) presets a deterministic PEPS is made (the random number generator is
+ * seeded with a fixed value), its environment is built with Environment::calc('A'), its energy is calculated, and one imaginary
+ * time step is done with propagate::step. Every stage is timed over a number of repetitions on copies of the same state, and the
+ * energies before and after the step are checked against the reference values stored below. A table is printed, and with an
+ * output file one JSON object per preset is appended to it, so the timings can be tracked from commit to commit. The exit status
+ * is 1 if an energy is off. The random streams are per OpenMP thread, so every reference is stored with the nr of threads it was made
+ * with, and its energies are not checked (but still timed) when omp_get_max_threads() differs from that.
+ * usage: bench_step [output file, - for none] [nr of repetitions, default 3]
+ */
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using std::cout;
+using std::endl;
+using std::vector;
+using std::complex;
+using std::ofstream;
+
+#include "include.h"
+
+using namespace btas;
+
+//!a benchmark point: lattice, virtual and auxiliary dimension, initial state ('J' Jastrow padded to D, 'R' random) and the reference energies
+struct Preset {
+
+   int L;
+   int D;
+   int D_aux;
+
+   char init;
+
+   //!nr of OpenMP threads with which the references were made
+   int threads;
+
+   //!energy of the initial state and after one step
+   double E0;
+   double E1;
+
+};
+
+//!the presets
+static const Preset presets[] = {
+
+   { 4, 2,  8, 'R', 1,  -0.731213759015944,  -0.799978086806115 },
+   { 6, 2,  8, 'J', 1, -14.5237354708837,   -14.5906953777553 },
+   { 6, 2, 12, 'J', 1, -14.5237354708837,   -14.5906953965776 },
+   { 6, 3,  9, 'J', 1, -13.8049234881584,   -13.9103829285594 }
+
+};
+
+//!seed of the random number generator
+static const unsigned long seed = 20261018;
+
+//!relative deviation from the references which is accepted
+static const double tolerance = 1.0e-8;
+
+/**
+ * @return seconds elapsed since start
+ */
+double elapsed(std::chrono::steady_clock::time_point start){
+
+   return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+}
+
+/**
+ * @return the minimum and the median of the times
+ */
+std::pair<double,double> stats(vector<double> times){
+
+   std::sort(times.begin(),times.end());
+
+   return std::make_pair(times[0],times[times.size() / 2]);
+
+}
+
+/**
+ * @return true if E agrees with the reference E_ref
+ */
+bool check(double E,double E_ref){
+
+   return std::fabs(E - E_ref) <= tolerance * std::fabs(E_ref);
+
+}
+
+int main(int argc,char *argv[]){
+
+   cout.precision(10);
+
+   const char *filename = (argc > 1 && std::string(argv[1]) != "-") ? argv[1] : 0;
+
+   int reps = (argc > 2) ? atoi(argv[2]) : 3;
+
+   if(reps < 1)
+      reps = 1;
+
+   int d = 2;
+   int J2 = 5;
+
+#ifdef _OPENMP
+   int threads = omp_get_max_threads();
+#else
+   int threads = 1;
+#endif
+
+   ofstream out;
+
+   if(filename){
+
+      out.open(filename,std::ios::app);
+
+      //not BTAS_THROW: this has to be checked in optimized builds as well
+      if(!out)
+         throw std::runtime_error(std::string("bench_step: could not open ") + filename);
+
+      out.precision(15);
+
+   }
+
+   bool pass = true;
+
+   cout << "#L\tD\tD_aux\tinit\tcalc (s)\tenergy (s)\tstep (s)\tE0\t\t\tE1\t\t\tcheck" << endl;
+
+   for(int p = 0;p < sizeof(presets) / sizeof(presets[0]);++p){
+
+      const Preset &preset = presets[p];
+
+      global::init(preset.D,preset.D_aux,d,preset.L,preset.L,J2,0.01,-10);
+
+      global::RN.seed(seed);
+
+      PEPS<double> peps_0(preset.D);
+
+      if(preset.init == 'R')
+         peps_0.fill_Random();
+      else{
+
+         peps_0.initialize_jastrow(0.74);
+
+         if(preset.D > peps_0.gD())
+            peps_0.grow_bond_dimension(preset.D,0.1);
+
+      }
+
+      peps_0.normalize();
+
+      peps_0.rescale_tensors(global::scal_num);
+      peps_0.normalize();
+
+      vector<double> t_calc,t_energy,t_step;
+
+      double E0 = 0.0;
+      double E1 = 0.0;
+
+      for(int r = 0;r < reps;++r){
+
+         PEPS<double> peps(peps_0);
+
+         //a fresh environment, so that every repetition starts from the same layers
+         global::env = Environment(preset.D,preset.D_aux,global::comp_sweeps);
+
+         std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+         global::env.calc('A',peps);
+
+         t_calc.push_back(elapsed(start));
+
+         start = std::chrono::steady_clock::now();
+
+         E0 = peps.energy();
+
+         t_energy.push_back(elapsed(start));
+
+         start = std::chrono::steady_clock::now();
+
+         propagate::step(peps,10);
+
+         t_step.push_back(elapsed(start));
+
+         peps.rescale_tensors(global::scal_num);
+         peps.normalize();
+
+         global::env.update('A',peps);
+         E1 = peps.energy();
+
+      }
+
+      std::pair<double,double> calc = stats(t_calc);
+      std::pair<double,double> energy = stats(t_energy);
+      std::pair<double,double> step = stats(t_step);
+
+      //the references only hold for the nr of threads they were made with
+      bool checked = (threads == preset.threads);
+
+      bool ok = check(E0,preset.E0) && check(E1,preset.E1);
+
+      if(checked)
+         pass = pass && ok;
+      else
+         std::cerr << "bench_step: the references of L = " << preset.L << ", D = " << preset.D << ", D_aux = " << preset.D_aux << " were made with "
+
+            << preset.threads << " thread(s), not " << threads << ": the energies are not checked" << endl;
+
+      cout << preset.L << "\t" << preset.D << "\t" << preset.D_aux << "\t" << preset.init << "\t" << std::setw(10) << calc.first << "\t" << std::setw(10) << energy.first
+
+         << "\t" << std::setw(10) << step.first << "\t" << std::setprecision(15) << E0 << "\t" << E1 << std::setprecision(10) << "\t" << (checked ? (ok ? "ok" : "FAIL") : "skip") << endl;
+
+      if(filename)
+         out << "{\"bench\":\"step\",\"L\":" << preset.L << ",\"D\":" << preset.D << ",\"D_aux\":" << preset.D_aux << ",\"init\":\"" << preset.init << "\""
+
+            << ",\"threads\":" << threads << ",\"reps\":" << reps
+
+            << ",\"calc_min\":" << calc.first << ",\"calc_median\":" << calc.second
+
+            << ",\"energy_min\":" << energy.first << ",\"energy_median\":" << energy.second
+
+            << ",\"step_min\":" << step.first << ",\"step_median\":" << step.second
+
+            << ",\"E0\":" << E0 << ",\"E1\":" << E1 << ",\"E0_ref\":" << preset.E0 << ",\"E1_ref\":" << preset.E1
+
+            << ",\"ref_threads\":" << preset.threads << ",\"pass\":" << (checked ? (ok ? "true" : "false") : "null") << "}" << endl;
+
+   }
+
+   return pass ? 0 : 1;
+
+}
@@ -0,0 +1,552 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <complex>
+#include <stdexcept>
+#include <algorithm>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <exception>
+
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using std::cout;
+using std::endl;
+using std::vector;
+using std::complex;
+
+#include "include.h"
+
+namespace checkpoint {
+
+   //!a file which waits to be written: the name, the staging buffer with its content and the last changes made before writing
+   struct Job {
+
+      std::string filename;
+
+      vector<char> *buffer;
+
+      std::function<void(vector<char> &)> finalize;
+
+   };
+
+   //!maximal nr of staging buffers: when all of them are in use, the next checkpoint waits for the writer
+   static const int MAX_STAGING = 2;
+
+   //!background thread which writes the queued jobs, started on the first submit
+   static std::thread writer;
+
+   //!protects everything below
+   static std::mutex lock;
+
+   //!signals new jobs to the writer, and finished jobs to the waiting threads
+   static std::condition_variable job_cv;
+   static std::condition_variable done_cv;
+
+   static std::deque<Job> queue;
+
+   //!staging buffers which are free for reuse, and the nr of buffers handed out
+   static vector< vector<char> * > pool;
+   static int staged = 0;
+
+   //!true while the writer is busy with a job, true when the writer has to stop
+   static bool busy = false;
+   static bool stop = false;
+
+   //!the first error the writer ran into
+   static std::exception_ptr error;
+
+   //!real data
+   template<>
+      uint32_t dtype<double>(){
+
+         return REAL;
+
+      }
+
+   //!complex data
+   template<>
+      uint32_t dtype< complex<double> >(){
+
+         return COMPLEX;
+
+      }
+
+   /**
+    * 64 bit FNV-1a hash, processed per 8 byte word so that it runs at memory speed
+    * @param data pointer to the data
+    * @param size nr of bytes
+    * @param hash the hash to continue, of the data before this part (whose size has to be a multiple of 8), the FNV offset basis by default
+    * @return the checksum
+    */
+   uint64_t checksum(const char *data,size_t size,uint64_t hash){
+
+      size_t words = size / sizeof(uint64_t);
+
+      for(size_t i = 0;i < words;++i){
+
+         uint64_t w;
+         memcpy(&w,data + i*sizeof(uint64_t),sizeof(uint64_t));
+
+         hash ^= w;
+         hash *= 1099511628211ULL;
+
+      }
+
+      for(size_t i = words * sizeof(uint64_t);i < size;++i){
+
+         hash ^= (unsigned char) data[i];
+         hash *= 1099511628211ULL;
+
+      }
+
+      return hash;
+
+   }
+
+   /**
+    * write a buffer to a file with a single write: the data go to filename.tmp first, which is synced and renamed,
+    * so that a crash never leaves a half written checkpoint behind
+    * @param filename name of the file
+    * @param buffer the content
+    */
+   void write(const std::string &filename,const vector<char> &buffer){
+
+      std::string tmp = filename + ".tmp";
+
+      int fd = open(tmp.c_str(),O_WRONLY | O_CREAT | O_TRUNC,0644);
+
+      //not BTAS_THROW: this has to be checked in optimized builds as well
+      if(fd == -1)
+         throw std::runtime_error("checkpoint::write: could not open " + tmp);
+
+      size_t done = 0;
+
+      while(done < buffer.size()){
+
+         ssize_t n = ::write(fd,buffer.data() + done,buffer.size() - done);
+
+         if(n <= 0){
+
+            close(fd);
+            throw std::runtime_error("checkpoint::write: write to " + tmp + " failed");
+
+         }
+
+         done += n;
+
+      }
+
+      fsync(fd);
+      close(fd);
+
+      if(rename(tmp.c_str(),filename.c_str()) != 0)
+         throw std::runtime_error("checkpoint::write: could not rename " + tmp);
+
+   }
+
+   /**
+    * map a file in memory, read only
+    * @param filename name of the file
+    * @param length output: the size of the file
+    * @return pointer to the content, to be released with unmap
+    */
+   const char *map(const std::string &filename,size_t &length){
+
+      int fd = open(filename.c_str(),O_RDONLY);
+
+      if(fd == -1)
+         throw std::runtime_error("checkpoint::map: could not open " + filename);
+
+      struct stat st;
+      fstat(fd,&st);
+
+      length = st.st_size;
+
+      if(length == 0){
+
+         close(fd);
+         throw std::runtime_error("checkpoint::map: " + filename + " is empty");
+
+      }
+
+      void *ptr = mmap(NULL,length,PROT_READ,MAP_PRIVATE,fd,0);
+
+      //the mapping stays valid after the file is closed
+      close(fd);
+
+      if(ptr == MAP_FAILED)
+         throw std::runtime_error("checkpoint::map: mmap of " + filename + " failed");
+
+      madvise(ptr,length,MADV_SEQUENTIAL);
+
+      return static_cast<const char *>(ptr);
+
+   }
+
+   /**
+    * release a file mapped with map
+    * @param ptr pointer returned by map
+    * @param length size of the file
+    */
+   void unmap(const char *ptr,size_t length){
+
+      munmap(const_cast<char *>(ptr),length);
+
+   }
+
+   /**
+    * write the complete state of the simulation: global parameters, the Trotter time step, the state of the random generator,
+    * the energy history, the PEPS and the environment layers. The state is copied into a staging buffer here, the file is written by
+    * the background writer while the simulation goes on.
+    * @param filename name of the checkpoint file
+    * @param step index of the next imaginary time step
+    * @param peps the PEPS<double>
+    * @param energy energies of the steps done so far
+    */
+   void save_state(const std::string &filename,int step,const PEPS<double> &peps,const vector<double> &energy){
+
+      State header;
+      memset(&header,0,sizeof(header));
+
+      strncpy(header.magic,"PEPSSTA",8);
+
+      header.version = VERSION;
+      header.step = step;
+      header.tau = global::trot.gtau();
+
+      header.Lx = global::Lx;
+      header.Ly = global::Ly;
+      header.d = global::d;
+      header.D = global::D;
+      header.D_aux = global::D_aux;
+      header.comp_sweeps = global::comp_sweeps;
+
+      header.J2 = global::J2;
+      header.scal_num = global::scal_num;
+      header.reg_const = global::reg_const;
+
+      header.log_norm = peps.glog_norm();
+
+      vector<char> *buffer = stage();
+
+      put(*buffer,header);
+
+      std::ostringstream rng;
+      global::RN.save(rng);
+
+      std::string rng_state = rng.str();
+
+      put(*buffer,(uint64_t)rng_state.size());
+      buffer->insert(buffer->end(),rng_state.begin(),rng_state.end());
+
+      put(*buffer,(uint64_t)energy.size());
+
+      for(int i = 0;i < energy.size();++i)
+         put(*buffer,energy[i]);
+
+      peps.serialize(*buffer);
+      global::env.serialize(*buffer,peps);
+
+      //size and checksum are filled in by the writer
+      submit(filename,buffer,[header](vector<char> &data) mutable {
+
+            header.bytes = data.size() - sizeof(State);
+            header.checksum = checksum(data.data() + sizeof(State),header.bytes);
+
+            memcpy(data.data(),&header,sizeof(header));
+
+      });
+
+   }
+
+   /**
+    * restore the complete state of the simulation written by save_state: the Trotter time step, the random generator, the PEPS, its
+    * environment and the energy history. The lattice has to be the one global::init was called with, D and D_aux are taken over.
+    * @param filename name of the checkpoint file
+    * @param peps output: the PEPS<double>
+    * @param energy output: energies of the steps done so far
+    * @return the index of the next imaginary time step
+    */
+   int load_state(const std::string &filename,PEPS<double> &peps,vector<double> &energy){
+
+      size_t length;
+      const char *block = map(filename,length);
+
+      State header;
+      memset(&header,0,sizeof(header));
+      memcpy(&header,block,std::min(length,sizeof(State)));
+
+      //not BTAS_THROW: these have to be checked in optimized builds as well
+      if(length < sizeof(State) || strncmp(header.magic,"PEPSSTA",8) != 0 || header.version != VERSION){
+
+         unmap(block,length);
+         throw std::runtime_error("checkpoint::load_state: " + filename + " is not a state checkpoint");
+
+      }
+
+      if(length < sizeof(State) + header.bytes || checksum(block + sizeof(State),header.bytes) != header.checksum){
+
+         unmap(block,length);
+         throw std::runtime_error("checkpoint::load_state: " + filename + " is corrupted");
+
+      }
+
+      if(header.Lx != global::Lx || header.Ly != global::Ly || header.d != global::d){
+
+         unmap(block,length);
+         throw std::runtime_error("checkpoint::load_state: lattice of " + filename + " does not match");
+
+      }
+
+      global::D_aux = header.D_aux;
+
+      if(header.D != global::D)
+         global::sD(header.D);
+
+      global::env.sD_aux(header.D_aux);
+
+      global::comp_sweeps = header.comp_sweeps;
+
+      global::J2 = header.J2;
+      global::scal_num = header.scal_num;
+      global::reg_const = header.reg_const;
+
+      global::stau(header.tau);
+
+      const char *ptr = block + sizeof(State);
+      const char *end = block + sizeof(State) + header.bytes;
+
+      uint64_t size;
+      get(ptr,size);
+
+      if(size > (uint64_t)(end - ptr)){
+
+         unmap(block,length);
+         throw std::runtime_error("checkpoint::load_state: " + filename + " is corrupted");
+
+      }
+
+      std::istringstream rng(std::string(ptr,size));
+      global::RN.load(rng);
+
+      ptr += size;
+
+      get(ptr,size);
+
+      if(size > (uint64_t)(end - ptr) / sizeof(double)){
+
+         unmap(block,length);
+         throw std::runtime_error("checkpoint::load_state: " + filename + " is corrupted");
+
+      }
+
+      energy.resize(size);
+
+      for(int i = 0;i < energy.size();++i)
+         get(ptr,energy[i]);
+
+      try {
+
+         ptr += peps.deserialize(ptr,end - ptr);
+         ptr += global::env.deserialize(ptr,peps);
+
+         peps.slog_norm(header.log_norm);
+
+      }
+      catch(...){
+
+         unmap(block,length);
+         throw;
+
+      }
+
+      unmap(block,length);
+
+      return header.step;
+
+   }
+
+   /**
+    * body of the writer thread: writes the queued jobs in order and recycles their staging buffers
+    */
+   static void run(){
+
+      std::unique_lock<std::mutex> guard(lock);
+
+      while(true){
+
+         job_cv.wait(guard,[]{ return stop || !queue.empty(); });
+
+         if(queue.empty())
+            return;
+
+         Job job = queue.front();
+         queue.pop_front();
+
+         busy = true;
+
+         //the I/O is done without holding the lock
+         guard.unlock();
+
+         try {
+
+            if(job.finalize)
+               job.finalize(*job.buffer);
+
+            write(job.filename,*job.buffer);
+
+         }
+         catch(...){
+
+            guard.lock();
+
+            if(!error)
+               error = std::current_exception();
+
+            guard.unlock();
+
+         }
+
+         //keep the capacity for the next checkpoint
+         job.buffer->clear();
+
+         guard.lock();
+
+         pool.push_back(job.buffer);
+         busy = false;
+
+         done_cv.notify_all();
+
+      }
+
+   }
+
+   /**
+    * stop the writer at exit, after the queued jobs have been written
+    */
+   static void shutdown(){
+
+      {
+         std::lock_guard<std::mutex> guard(lock);
+         stop = true;
+      }
+
+      job_cv.notify_all();
+
+      if(writer.joinable())
+         writer.join();
+
+      for(int i = 0;i < pool.size();++i)
+         delete pool[i];
+
+      pool.clear();
+
+   }
+
+   /**
+    * get an empty staging buffer for the next file. Buffers are reused, so after the first checkpoints filling them costs a memcpy and
+    * no page faults. If all buffers are still waiting to be written, this waits for the writer.
+    * @return the staging buffer, to be handed to submit
+    */
+   vector<char> *stage(){
+
+      std::unique_lock<std::mutex> guard(lock);
+
+      if(pool.empty() && staged < MAX_STAGING){
+
+         ++staged;
+         return new vector<char>;
+
+      }
+
+      done_cv.wait(guard,[]{ return !pool.empty(); });
+
+      vector<char> *buffer = pool.back();
+      pool.pop_back();
+
+      return buffer;
+
+   }
+
+   /**
+    * hand a filled staging buffer to the background writer, which writes it with write: through a tmp file, fsync and rename.
+    * Files are written in the order in which they are submitted.
+    * @param filename name of the file
+    * @param buffer staging buffer obtained from stage, it is returned to the pool after the write
+    * @param finalize called on the buffer by the writer before the write, e.g. to fill in a checksum, may be empty
+    */
+   void submit(const std::string &filename,vector<char> *buffer,std::function<void(vector<char> &)> finalize){
+
+      {
+         std::lock_guard<std::mutex> guard(lock);
+
+         if(!writer.joinable()){
+
+            writer = std::thread(run);
+            atexit(shutdown);
+
+         }
+
+         Job job;
+
+         job.filename = filename;
+         job.buffer = buffer;
+         job.finalize = finalize;
+
+         queue.push_back(job);
+
+      }
+
+      job_cv.notify_one();
+
+   }
+
+   /**
+    * wait until all submitted files have been written, errors of the writer are thrown here
+    */
+   void wait(){
+
+      std::unique_lock<std::mutex> guard(lock);
+
+      done_cv.wait(guard,[]{ return queue.empty() && !busy; });
+
+      if(error){
+
+         std::exception_ptr e = error;
+         error = std::exception_ptr();
+
+         std::rethrow_exception(e);
+
+      }
+
+   }
+
+   /**
+    * @param name path
+    * @return true if name is an existing directory
+    */
+   bool is_directory(const std::string &name){
+
+      struct stat st;
+
+      if(stat(name.c_str(),&st) != 0)
+         return false;
+
+      return S_ISDIR(st.st_mode);
+
+   }
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -2,6 +2,7 @@
 #include <iomanip>
 #include <fstream>
 #include <complex>
+#include <cmath>
 
 using std::cout;
 using std::endl;
@@ -25,6 +26,8 @@ namespace contractions {
     */
    void update_L(char option,int col,const PEPS<double> &peps,DArray<5> &L){
 
+      PROFILE_SCOPE("update_L");
+
       if(option == 'b'){//row == 0
 
          DArray<7> tmp7;
@@ -78,6 +81,8 @@ namespace contractions {
     */
    void init_ro(int row,const PEPS<double> &peps,vector< DArray<6> > &RO){
 
+      PROFILE_SCOPE("init_ro");
+
       DArray<8> tmp8;
       DArray<8> tmp8bis;
 
@@ -140,6 +145,8 @@ namespace contractions {
     */
    void init_ro(char option,const PEPS<double> &peps,vector< DArray<5> > &R){
 
+      PROFILE_SCOPE("init_ro");
+
       if(option == 'b'){
 
          R[Lx-1].resize( shape(1,1,1,1,1) );
@@ -208,6 +215,8 @@ namespace contractions {
     */
    void update_L(int row,int col,const PEPS<double> &peps,DArray<6> &LO){
 
+      PROFILE_SCOPE("update_L");
+
       DArray<8> tmp8;
       Gemm(CblasTrans,CblasNoTrans,1.0,LO,env.gt(row)[col],0.0,tmp8);
 
@@ -236,6 +245,8 @@ namespace contractions {
     */
    double rescale_norm(int row,PEPS<double> &peps,vector< DArray<6> > &RO){
 
+      PROFILE_SCOPE("rescale_norm");
+
       DArray<8> tmp8;
       DArray<8> tmp8bis;
 
@@ -307,6 +318,8 @@ namespace contractions {
       for(int col = 0;col < Lx;++col)
          Scal(1.0/nrm,peps(row-1,col));
 
+      peps.slog_norm(peps.glog_norm() + 0.5 * log(full_nrm));
+
       return full_nrm;
 
    }
@@ -318,6 +331,8 @@ namespace contractions {
     */
    double rescale_norm(char option,PEPS<double> &peps,vector< DArray<5> > &R){
 
+      PROFILE_SCOPE("rescale_norm");
+
       if(option == 'b'){
 
          DArray<7> tmp7;
@@ -370,6 +385,8 @@ namespace contractions {
          //finally rescale all the tensors
          peps.scal(1.0/sqrt(full_nrm));
 
+         peps.slog_norm(peps.glog_norm() + 0.5 * log(full_nrm));
+
          return full_nrm;
 
       }
@@ -418,10 +435,27 @@ namespace contractions {
          for(int col = 0;col < Lx;++col)
             Scal(1.0/nrm,peps(Ly-3,col));
 
+         peps.slog_norm(peps.glog_norm() + 0.5 * log(full_nrm));
+
          return full_nrm;
 
       }
 
    }
 
+   /**
+    * apply a stack of one-site operators to a peps tensor, the stacked counterpart of applying ham.gL(i) or ham.gR(i) for every i
+    * @param op stack of operators (i,phys_out,phys_in), e.g. ham.gL_stack()
+    * @param A the peps tensor (left,up,phys,down,right)
+    * @param peps_op output: stack of operated peps tensors (i,left,up,phys,down,right)
+    */
+   void apply_stack(const DArray<3> &op,const DArray<5> &A,DArray<6> &peps_op){
+
+      enum {i,j,k,l,m,n,o};
+
+      peps_op.clear();
+      Contract(1.0,op,shape(i,j,k),A,shape(l,m,k,n,o),0.0,peps_op,shape(i,l,m,j,n,o));
+
+   }
+
 }
@@ -0,0 +1,451 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+#include <new>
+#include <cstdlib>
+#include <cstdio>
+
+#include <malloc.h>
+
+using std::cout;
+using std::endl;
+
+#include "include.h"
+
+namespace footprint {
+
+#ifdef _FOOTPRINT
+   //!bytes on the heap and their high-water mark, for the whole process
+   static std::atomic<long long> used(0);
+   static std::atomic<long long> high(0);
+#endif
+
+   //!the budget in bytes, 0 if there is none
+   static std::atomic<long long> limit(0);
+
+#ifdef _FOOTPRINT
+   //!net bytes allocated by this thread, and their high-water mark since the innermost open tag started
+   static thread_local long long net = 0;
+   static thread_local long long mark = 0;
+
+   //!what has been recorded under a tag
+   struct Entry {
+
+      long calls;
+
+      //!largest transient allocation of a single call
+      double peak;
+
+   };
+
+   //!the tags recorded by a thread, by the address of their name: tags end without locking, the tables are merged by report
+   typedef std::map<const char *,Entry> Table;
+
+   //!the table of this thread, and those of all the threads which recorded a tag
+   static thread_local Table *table = 0;
+
+   static std::vector<Table *> tables;
+
+   //!protects tables
+   static std::mutex lock;
+
+   /**
+    * allocate from the heap and count the usable size of the block. The request is added to the heap before it is checked against the budget,
+    * so concurrent allocations cannot all pass the check and overshoot it together.
+    * @param n nr of bytes requested
+    * @return the block, 0 if it could not be allocated or would exceed the budget
+    */
+   static void *allocate(size_t n){
+
+      long long budget = limit.load(std::memory_order_relaxed);
+
+      long long now = used.fetch_add(n,std::memory_order_relaxed) + n;
+
+      if(budget > 0 && now > budget){
+
+         used.fetch_sub(n,std::memory_order_relaxed);
+
+         //no iostreams here: they could allocate
+         fprintf(stderr,"footprint: allocation of %zu bytes refused, %lld bytes in use, budget %lld bytes\n",n,now - (long long) n,budget);
+
+         return 0;
+
+      }
+
+      void *block = malloc(n ? n : 1);
+
+      if(!block){
+
+         used.fetch_sub(n,std::memory_order_relaxed);
+         return 0;
+
+      }
+
+      //the block may be larger than requested
+      long long size = malloc_usable_size(block);
+
+      now = used.fetch_add(size - (long long) n,std::memory_order_relaxed) + size - (long long) n;
+
+      long long top = high.load(std::memory_order_relaxed);
+
+      while(now > top && !high.compare_exchange_weak(top,now,std::memory_order_relaxed))
+         ;
+
+      net += size;
+
+      if(net > mark)
+         mark = net;
+
+      return block;
+
+   }
+
+   /**
+    * give a block back to the heap
+    */
+   static void release(void *block){
+
+      if(!block)
+         return;
+
+      long long size = malloc_usable_size(block);
+
+      used.fetch_sub(size,std::memory_order_relaxed);
+      net -= size;
+
+      free(block);
+
+   }
+
+   /**
+    * start a tag
+    * @param name_in name of the call site
+    */
+   Tag::Tag(const char *name_in){
+
+      name = name_in;
+
+      entry = net;
+      outer = mark;
+
+      mark = net;
+
+   }
+
+   /**
+    * the tag ends: the largest amount of memory allocated on top of what the thread held when it started is recorded in the table of the thread
+    */
+   Tag::~Tag(){
+
+      long long inner = mark;
+
+      //first tag of the thread
+      if(!table){
+
+         table = new Table;
+
+         std::lock_guard<std::mutex> guard(lock);
+         tables.push_back(table);
+
+      }
+
+      Entry &record = (*table)[name];
+
+      record.calls++;
+      record.peak = std::max(record.peak,(double)(inner - entry));
+
+      mark = std::max(outer,inner);
+
+   }
+#endif
+
+   /**
+    * @return the nr of bytes currently on the heap, 0 without -D_FOOTPRINT
+    */
+   double current(){
+
+#ifdef _FOOTPRINT
+      return used.load();
+#else
+      return 0.0;
+#endif
+
+   }
+
+   /**
+    * @return the largest nr of bytes there have been on the heap since the start or the last reset_peak, 0 without -D_FOOTPRINT
+    */
+   double peak(){
+
+#ifdef _FOOTPRINT
+      return high.load();
+#else
+      return 0.0;
+#endif
+
+   }
+
+   /**
+    * start measuring the peak from the current use
+    */
+   void reset_peak(){
+
+#ifdef _FOOTPRINT
+      high = used.load();
+#endif
+
+   }
+
+   /**
+    * set the budget: with -D_FOOTPRINT allocations which would take the heap above it are refused with std::bad_alloc, without it the budget
+    * is only used to plan the run
+    * @param bytes the budget in bytes, 0 for none
+    */
+   void sbudget(double bytes){
+
+      limit = (long long) bytes;
+
+   }
+
+   /**
+    * @return the budget in bytes, 0 if there is none
+    */
+   double gbudget(){
+
+      return limit.load();
+
+   }
+
+   /**
+    * print the current and peak use of the heap, and the transient peak of every tag summed over the threads, in MB. The tables of the
+    * threads are read without their owners knowing, so this is called outside of parallel regions.
+    * @param out the stream to print to
+    */
+   void report(ostream &out){
+
+#ifdef _FOOTPRINT
+      std::map<std::string,Entry> entries;
+
+      {
+         std::lock_guard<std::mutex> guard(lock);
+
+         for(int i = 0;i < tables.size();++i)
+            for(Table::const_iterator it = tables[i]->begin();it != tables[i]->end();++it){
+
+               Entry &record = entries[it->first];
+
+               record.calls += it->second.calls;
+               record.peak = std::max(record.peak,it->second.peak);
+
+            }
+      }
+
+      std::ios::fmtflags flags = out.flags();
+      std::streamsize precision = out.precision();
+
+      out << std::fixed << std::setprecision(3);
+
+      out << endl;
+      out << "#heap (MB)\tcurrent\t" << 1.0e-6 * current() << "\tpeak\t" << 1.0e-6 * peak() << "\tbudget\t" << 1.0e-6 * gbudget() << endl;
+
+      out << std::left << std::setw(40) << "#tag" << std::right << std::setw(12) << "calls" << std::setw(16) << "peak (MB)" << endl;
+
+      for(std::map<std::string,Entry>::const_iterator it = entries.begin();it != entries.end();++it)
+         out << std::left << std::setw(40) << it->first << std::right << std::setw(12) << it->second.calls << std::setw(16) << 1.0e-6 * it->second.peak << endl;
+
+      out << endl;
+
+      out.flags(flags);
+      out.precision(precision);
+#else
+      out << "#heap: not accounted, build with -D_FOOTPRINT" << endl;
+#endif
+
+   }
+
+   /**
+    * predict the memory of a run: the PEPS and the boundary layers, and the transient peaks of an update, of a row pair of PEPS::energy and of
+    * add_layer. The transients scale with their largest intermediates, X^2 D^6 for the update and the energy and X^2 D^4 for add_layer, and the
+    * prefactors are those measured with the tags of these call sites (they include the copies Contract makes and the stacked operator index of
+    * the batched energy). Parallel regions multiply the transients: the row pairs of PEPS::energy run as tasks, and add_layer compresses
+    * 'blocks' blocks at once. bench_footprint checks the prediction against the measured peak: for a single thread it is 2 to 8% above it
+    * (L = 6 and 8, D = 2 and 3, D_aux = 8 and 9). With more threads it assumes the parallel parts all peak at the same time, which they rarely
+    * do: it is an upper bound, e.g. 3.6 MB against a measured 1.8 MB for 4 threads at L = 6, D = 2, D_aux = 8.
+    * @param Lx nr of columns
+    * @param Ly nr of rows
+    * @param d physical dimension
+    * @param D virtual dimension
+    * @param D_aux auxiliary dimension
+    * @param threads nr of OpenMP threads
+    * @param blocks nr of column blocks compressed in parallel
+    * @param capacity nr of environment layers kept in memory, 0 for all
+    * @return the prediction
+    */
+   Plan estimate(int Lx,int Ly,int d,int D,int D_aux,int threads,int blocks,int capacity){
+
+      const double w = sizeof(double);
+
+      double D2 = (double)D * D;
+      double D4 = D2 * D2;
+      double D6 = D4 * D2;
+
+      double X2 = (double)D_aux * D_aux;
+
+      int n = 2 * (Ly - 1);
+
+      Plan plan;
+
+      plan.threads = threads;
+      plan.capacity = capacity;
+
+      plan.peps = w * Lx * Ly * d * D4;
+
+      plan.layers = w * ((capacity > 0) ? std::min(capacity,n) : n) * Lx * X2 * D2;
+
+      //the operators of the columns, LI8/RI8 and the intermediates of calc_N_eff, and N_eff with the copies made by solve
+      plan.step = w * (15.0 * X2 * D6 + Lx * X2 * D4 + 3.0 * D4 * D4);
+
+      plan.energy = w * (25.0 * X2 * D6 + Lx * X2 * D4);
+
+      plan.environment = w * 12.0 * X2 * D4;
+
+      //the parts of the energy run in parallel only if all the layers are in memory
+      int parts = (capacity == 0) ? std::min(Ly - 1,threads) : 1;
+
+      plan.peak = plan.peps + plan.layers + std::max(plan.step,std::max(parts * plan.energy,std::min(blocks,threads) * plan.environment));
+
+      return plan;
+
+   }
+
+   /**
+    * fit a run in a budget: if the predicted peak exceeds it, the nr of threads is halved down to one, and then the environment layers are
+    * moved out of core, keeping four of them in memory. There is no way to shrink the intermediates of an update other than lowering the
+    * dimensions, so if it still does not fit the run is refused. A tenth of the budget is kept free for what the estimate does not cover (the
+    * heap of the libraries, the buffers of the store).
+    * @param budget the budget in bytes
+    * @return the plan which fits, the other arguments are those of estimate
+    */
+   Plan fit(int Lx,int Ly,int d,int D,int D_aux,int threads,int blocks,int capacity,double budget){
+
+      double room = 0.9 * budget;
+
+      Plan plan = estimate(Lx,Ly,d,D,D_aux,threads,blocks,capacity);
+
+      while(plan.peak > room && plan.threads > 1)
+         plan = estimate(Lx,Ly,d,D,D_aux,plan.threads / 2,blocks,capacity);
+
+      if(plan.peak > room && (capacity == 0 || capacity > 4))
+         plan = estimate(Lx,Ly,d,D,D_aux,plan.threads,blocks,4);
+
+      //not BTAS_THROW: this has to be checked in optimized builds as well
+      if(plan.peak > room){
+
+         std::ostringstream msg;
+
+         msg << "footprint::fit: predicted peak of " << 1.0e-9 * plan.peak << " GB exceeds 90% of the budget of " << 1.0e-9 * budget
+
+            << " GB with a single thread and the environment out of core, lower D or D_aux";
+
+         throw std::runtime_error(msg.str());
+
+      }
+
+      return plan;
+
+   }
+
+   /**
+    * print a plan, in MB
+    * @param out the stream to print to
+    * @param plan the plan
+    */
+   void print(ostream &out,const Plan &plan){
+
+      std::ios::fmtflags flags = out.flags();
+      std::streamsize precision = out.precision();
+
+      out << std::fixed << std::setprecision(3);
+
+      out << "#plan (MB)\tthreads\t" << plan.threads << "\tresident layers\t" << plan.capacity << "\tpeps\t" << 1.0e-6 * plan.peps << "\tlayers\t" << 1.0e-6 * plan.layers
+
+         << "\tstep\t" << 1.0e-6 * plan.step << "\tenergy\t" << 1.0e-6 * plan.energy << "\tenvironment\t" << 1.0e-6 * plan.environment
+
+         << "\tpeak\t" << 1.0e-6 * plan.peak << endl;
+
+      out.flags(flags);
+      out.precision(precision);
+
+   }
+
+}
+
+#ifdef _FOOTPRINT
+//every allocation of the program goes through the accounting
+void *operator new(size_t n){
+
+   void *block = footprint::allocate(n);
+
+   if(!block)
+      throw std::bad_alloc();
+
+   return block;
+
+}
+
+void *operator new[](size_t n){
+
+   void *block = footprint::allocate(n);
+
+   if(!block)
+      throw std::bad_alloc();
+
+   return block;
+
+}
+
+void *operator new(size_t n,const std::nothrow_t &) noexcept {
+
+   return footprint::allocate(n);
+
+}
+
+void *operator new[](size_t n,const std::nothrow_t &) noexcept {
+
+   return footprint::allocate(n);
+
+}
+
+void operator delete(void *block) noexcept {
+
+   footprint::release(block);
+
+}
+
+void operator delete[](void *block) noexcept {
+
+   footprint::release(block);
+
+}
+
+void operator delete(void *block,const std::nothrow_t &) noexcept {
+
+   footprint::release(block);
+
+}
+
+void operator delete[](void *block,const std::nothrow_t &) noexcept {
+
+   footprint::release(block);
+
+}
+#endif
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -97,7 +97,18 @@ namespace global{
 
       D = D_in;
 
+      char method = env.gmethod();
+      int blocks = env.gblocks();
+      char init = env.ginit();
+
+      int capacity = env.gstore().gcapacity();
+      std::string dir = env.gstore().gdir();
+
       env = Environment(D,D_aux,comp_sweeps);
+      env.smethod(method);
+      env.sblocks(blocks);
+      env.sinit(init);
+      env.sstore(capacity,dir);
 
    }
 
@@ -107,7 +118,17 @@ namespace global{
     */
    void stau(double tau){
 
-      trot = Trotter(tau);
+      trot = Trotter(tau,trot.gtol());
+
+   }
+
+   /**
+    * set the tolerance of the split of the gates, see Trotter::split
+    * @param tol singular values below tol times the largest one are dropped
+    */
+   void stol(double tol){
+
+      trot = Trotter(trot.gtau(),tol);
 
    }
 
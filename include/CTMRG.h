@@ -0,0 +1,81 @@
+#ifndef CTMRG_H
+#define CTMRG_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+#include <btas/common/blas_cxx_interface.h>
+#include <btas/common/TVector.h>
+#include <btas/DENSE/TArray.h>
+
+using std::ostream;
+using std::vector;
+
+using namespace btas;
+
+template<typename T>
+class PEPS;
+
+class Environment;
+
+/**
+ * Corner transfer matrix renormalization group engine for the finite lattice. The edge tensors are the boundary 'MPO' layers of an Environment object,
+ * which are grown by directional moves: a 'b'ottom move absorbs a peps row into b[row-1], a 't'op move absorbs one into t[row+1]. Instead of
+ * the variational compression, the new bonds are truncated with projectors obtained from the corner tensors: the left and right halves of the
+ * two-row strip closed by the opposite boundary layer. The moves are iterated until the norm of the state has converged.
+ */
+class CTMRG {
+
+   public:
+
+      CTMRG();
+
+      CTMRG(int,double);
+
+      //copy constructor
+      CTMRG(const CTMRG &);
+
+      //destructor
+      virtual ~CTMRG();
+
+      int calc(const PEPS<double> &,Environment &,bool);
+
+      void move(const char,int,const PEPS<double> &,Environment &);
+
+      int gmax_iter() const;
+
+      double gtol() const;
+
+      double gconv() const;
+
+   private:
+
+      void corners(const char,int,const PEPS<double> &,const Environment &);
+
+      void projectors(const char,int,int);
+
+      bool compatible(int,const PEPS<double> &,const Environment &) const;
+
+      //!left and right corners of the strip: leg order (top bond, upper ket, upper bra, lower ket, lower bra, bottom bond)
+      vector< DArray<6> > C_L;
+      vector< DArray<6> > C_R;
+
+      //!projectors on the bonds between column i and i+1: P_L[i] on the left side, P_R[i] on the right side
+      vector< DArray<4> > P_L;
+      vector< DArray<4> > P_R;
+
+      //!maximal number of down/up iterations
+      int max_iter;
+
+      //!tolerance on the relative change of the norm
+      double tol;
+
+      //!relative change of the norm in the last iteration
+      double conv;
+
+};
+
+#endif
+
+/* vim: set ts=3 sw=3 expandtab :*/
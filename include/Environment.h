@@ -4,6 +4,7 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <string>
 
 #include <btas/common/blas_cxx_interface.h>
 #include <btas/common/TVector.h>
@@ -18,6 +19,9 @@ class PEPS;
 template<typename T>
 class MPO;
 
+#include "CTMRG.h"
+#include "MPOStore.h"
+
 /**
  * @author Brecht Verstichel
  * @data 02-05-2014\n\n
@@ -37,8 +41,22 @@ class Environment {
       //destructor
       virtual ~Environment();
 
+      Environment &operator=(const Environment &);
+
       void calc(const char,PEPS<double> &);
 
+      void update(const char,PEPS<double> &);
+
+      void update(const char,int,PEPS<double> &);
+
+      bool stale(const char,int,const PEPS<double> &) const;
+
+      void fill(const char,const PEPS<double> &);
+
+      void scal_row(int,double,const PEPS<double> &);
+
+      void gauge(int,const vector< DArray<2> > &,const PEPS<double> &);
+
       void add_layer(const char,int,PEPS<double> &);
 
       double cost_function(const char,int,int,const PEPS<double> &,const std::vector< DArray<4> > &);
@@ -64,11 +82,65 @@ class Environment {
 
       void init_svd(char,int,const PEPS<double> &);
 
+      char gmethod() const;
+
+      void smethod(char);
+
+      CTMRG &gctm();
+
+      const CTMRG &gctm() const;
+
+      int gblocks() const;
+
+      void sblocks(int);
+
+      void sstore(int,const std::string &);
+
+      const MPOStore &gstore() const;
+
+      void prefetch(const char,int) const;
+
+      void serialize(vector<char> &,const PEPS<double> &) const;
+
+      size_t deserialize(const char *,const PEPS<double> &);
+
+      char ginit() const;
+
+      void sinit(char);
+
+      void sfidelity(bool);
+
+      double ginit_time() const;
+
+      int ginit_count() const;
+
+      double ginit_fidelity() const;
+
    private:
 
-      //!stores an array environment MPO's for t(op) and b(ottom)
-      vector< MPO<double> > t;
-      vector< MPO<double> > b;
+      void load(const char,int) const;
+
+      void stamp(const char,int,const PEPS<double> &);
+
+      void compress_blocks(const char,int,const PEPS<double> &);
+
+      void target(const char,int,int,const PEPS<double> &,const DArray<4> &,DArray<6> &) const;
+
+      void env_R(const char,int,int,const PEPS<double> &,const DArray<4> &,const DArray<4> &,DArray<4> &) const;
+
+      void pseudo_inverse(const DArray<2> &,DArray<2> &) const;
+
+      void init_layer(const char,int,const PEPS<double> &);
+
+      void truncate(DArray<6> &,DArray<4> &,DArray<4> &) const;
+
+      //!stores an array environment MPO's for t(op) and b(ottom), mutable because layers are (re)loaded from the store on access
+      mutable vector< MPO<double> > t;
+      mutable vector< MPO<double> > b;
+
+      //!versions of the peps rows from which the t(op) and b(ottom) layers were constructed: b[i] depends on rows 0..i, t[i] on rows i+2..Ly-1
+      vector< vector<unsigned long> > t_ver;
+      vector< vector<unsigned long> > b_ver;
 
       //!regular bond dimension of peps
       int D;
@@ -79,6 +151,32 @@ class Environment {
       //!nr of sweeps in compression
       int comp_sweeps;
 
+      //!contraction method: 'M' for the variational boundary 'MPO' compression, 'C' for CTMRG
+      char method;
+
+      //!CTMRG engine, used when method == 'C'
+      CTMRG ctm;
+
+      //!nr of column blocks which are compressed in parallel, 1 means the serial sweep
+      int blocks;
+
+      //!initial guess of a new layer: 'S' truncated svd's, 'Z' zip-up with randomized QR projections, 'P' the previous layer if there is one
+      char init;
+
+      //!if true the fidelity of every initial guess with the compressed layer is measured
+      bool fidelity;
+
+      //!wall time spent in the initialization of the layers and the nr of initializations
+      double init_time;
+      int init_count;
+
+      //!sum and nr of the measured fidelities of the initial guesses
+      double init_fid;
+      int fid_count;
+
+      //!out-of-core storage of the layers: layer ids are i for t[i] and Ly - 2 + i for b[i]
+      mutable MPOStore store;
+
 };
 
 #endif
@@ -51,6 +51,12 @@ class Hamiltonian {
 
       const std::vector<double> &gcoef_nn() const;
 
+      const DArray<3> &gL_stack() const;
+
+      const DArray<3> &gR_n() const;
+
+      const DArray<3> &gR_nn() const;
+
    private:
 
       //!number of terms in the hamiltonian (i.e. 3 in Heisenberg, 2 in XY model, 1 for ising,...)
@@ -66,6 +72,13 @@ class Hamiltonian {
       std::vector< DArray<2> > L;
       std::vector< DArray<2> > R;
 
+      //!the left operators stacked along a leading operator index: (i,phys_out,phys_in)
+      DArray<3> L_stack;
+
+      //!the right operators stacked along a leading operator index and multiplied with coef_n[i] and coef_nn[i] respectively
+      DArray<3> R_n;
+      DArray<3> R_nn;
+
 };
 
 #endif
@@ -0,0 +1,99 @@
+#ifndef MPOSTORE_H
+#define MPOSTORE_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <list>
+#include <string>
+
+#include <btas/common/blas_cxx_interface.h>
+#include <btas/common/TVector.h>
+#include <btas/DENSE/TArray.h>
+
+using std::ostream;
+using std::vector;
+
+using namespace btas;
+
+template<typename T>
+class MPO;
+
+/**
+ * Out-of-core storage for the boundary 'MPO' layers of the Environment. The layers are identified by an integer, at most 'capacity' of them
+ * are kept in memory, the least recently used ones are written to a memory mapped scratch file and their memory is released.
+ * The scratch file is unlinked as soon as it is created, so it disappears with the process.
+ */
+class MPOStore {
+
+   public:
+
+      MPOStore();
+
+      MPOStore(int,int,const std::string &);
+
+      //copy constructor
+      MPOStore(const MPOStore &);
+
+      //destructor
+      virtual ~MPOStore();
+
+      MPOStore &operator=(const MPOStore &);
+
+      int gcapacity() const;
+
+      const std::string &gdir() const;
+
+      bool resident(int) const;
+
+      bool stored(int) const;
+
+      int touch(int);
+
+      void write(int,MPO<double> &);
+
+      void read(int,MPO<double> &);
+
+      void prefetch(int) const;
+
+      void scal(int,double);
+
+   private:
+
+      void open();
+
+      //!maximal nr of resident layers, 0 means everything stays in memory
+      int capacity;
+
+      //!directory in which the scratch file is created
+      std::string dir;
+
+      //!file descriptor of the scratch file, -1 if it has not been created
+      int fd;
+
+      //!current length of the scratch file
+      size_t length;
+
+      //!offset, size and reserved size in bytes of every layer in the scratch file
+      vector<size_t> offset;
+      vector<size_t> bytes;
+      vector<size_t> reserved;
+
+      //!shapes of the tensors of the stored layers
+      vector< vector< IVector<4> > > shapes;
+
+      //!scaling factors which have to be applied when a stored layer is read
+      vector<double> factor;
+
+      //!layers on disk and layers in memory
+      vector<bool> on_disk;
+      vector<bool> in_memory;
+
+      //!resident layers, most recently used in front
+      std::list<int> lru;
+
+};
+
+#endif
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -45,6 +45,8 @@ class MPS : public vector< TArray<T,3> > {
 
       void gemv(char , const MPO<T> &);
 
+      void gemv(char , const MPO<T> &,int,int = 2);
+
       void canonicalize(const BTAS_SIDE &,bool);
 
       void scal(T );
@@ -55,6 +57,8 @@ class MPS : public vector< TArray<T,3> > {
 
    private:
 
+      void fit(const MPS<T> &,const vector< TArray<T,4> > &,int);
+
       //!dimension of the bonds
       int D;
 
@@ -0,0 +1,143 @@
+#ifndef MEASUREMENT_H
+#define MEASUREMENT_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+
+#include <btas/common/blas_cxx_interface.h>
+#include <btas/common/TVector.h>
+#include <btas/DENSE/TArray.h>
+
+using std::ostream;
+using std::vector;
+
+using namespace btas;
+
+template<typename T>
+class PEPS;
+
+template<typename T>
+class MPO;
+
+template<typename T>
+class MPS;
+
+/**
+ * Measurement engine for a batch of observables on the same state. An observable ('term') is a sum of products of one-site operators:
+ * on a single site, on two sites, or on two sites of the same row with a string operator on every site in between. The environment is
+ * calculated once, after which every row pair (row,row+1) is swept from left to right between its boundary layers: the left and right
+ * renormalized operators of the strip are shared by all products on that row pair, and the left operators carrying the same first operator
+ * are shared by all products which start with it. Products whose sites lie further apart vertically are evaluated by moving the bottom
+ * layer of the lower site up, with its operator in it, until it closes the strip of the upper site (see transfer).
+ */
+class Measurement {
+
+   public:
+
+      Measurement();
+
+      //copy constructor
+      Measurement(const Measurement &);
+
+      //destructor
+      virtual ~Measurement();
+
+      int add_operator(const DArray<2> &);
+
+      int term(const std::string &);
+
+      void add(int,double,int,int,int);
+
+      void add(int,double,int,int,int,int,int,int);
+
+      void add_string(int,double,int,int,int,int,int,int);
+
+      int spin_correlation(int,int,int,int);
+
+      void correlation_map(int,int);
+
+      void correlations();
+
+      void dimers();
+
+      void measure(PEPS<double> &);
+
+      int size() const;
+
+      double gvalue(int) const;
+
+      const std::string &gname(int) const;
+
+      double gnorm(int) const;
+
+      double gdimer(const char) const;
+
+      double structure_factor(double,double) const;
+
+      void print(ostream &) const;
+
+   private:
+
+      //!a product of one-site operators: opA on siteA, opB on siteB (-1 for a one-site product), opS on the sites of the string in between (-1 if none)
+      struct Product {
+
+         int term;
+
+         double coef;
+
+         int rowA;
+         int colA;
+         int opA;
+
+         int rowB;
+         int colB;
+         int opB;
+
+         int opS;
+
+      };
+
+      void spin_operators();
+
+      void layers(int,MPO<double> &,MPO<double> &) const;
+
+      void step(const DArray<6> &,int,int,const MPO<double> &,const MPO<double> &,const PEPS<double> &,const DArray<2> *,const DArray<2> *,DArray<6> &) const;
+
+      void step_right(const DArray<6> &,int,int,const MPO<double> &,const MPO<double> &,const PEPS<double> &,DArray<6> &) const;
+
+      double measure_pair(int,const MPO<double> &,const MPO<double> &,const PEPS<double> &,const vector<Product> &,vector<double> &,bool = true) const;
+
+      void transfer(int,const PEPS<double> &,int,const DArray<2> *,MPS<double> &) const;
+
+      void measure_long(int,const PEPS<double> &,const vector<int> &,vector<double> &,vector<double> &) const;
+
+      //!the registered one-site operators
+      vector< DArray<2> > ops;
+
+      //!names of the terms and their values after measure
+      vector<std::string> names;
+      vector<double> values;
+
+      //!norm of the state on the row pair of every term, as seen by its boundary layers
+      vector<double> norms;
+
+      //!products making up the terms
+      vector<Product> products;
+
+      //!ids of Sx, iSy and Sz, -1 if they have not been registered yet
+      int spin[3];
+
+      //!terms of the nearest neighbour spin correlations added by dimers(): horizontal bonds (row,col)-(row,col+1), vertical bonds (row,col)-(row+1,col)
+      vector<int> h_bond;
+      vector<int> v_bond;
+
+      //!terms of the spin correlations of all pairs of sites added by correlations(): [row_1*Lx + col_1][row_2*Lx + col_2], -1 on the diagonal
+      vector< vector<int> > corr;
+
+};
+
+#endif
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -33,6 +33,8 @@ class PEPS : public vector< TArray<T,5> > {
       //copy constructor
       PEPS(const PEPS &);
 
+      PEPS &operator=(const PEPS &);
+
       //destructor
       virtual ~PEPS();
 
@@ -62,6 +64,12 @@ class PEPS : public vector< TArray<T,5> > {
 
       void load(const char *);
 
+      void load_txt(const char *);
+
+      void serialize(vector<char> &) const;
+
+      size_t deserialize(const char *,size_t);
+
       void rescale_tensors(double);
 
       void rescale_tensors(int,double);
@@ -69,13 +77,36 @@ class PEPS : public vector< TArray<T,5> > {
       //heisenberg energy expectation value
       double energy();
 
+      //contributions of the row pairs, also used by propagate::step with its own right operators
+      double energy_bottom(const vector< DArray<5> > &) const;
+
+      double energy_row(int,const vector< DArray<6> > &) const;
+
+      double energy_top(const vector< DArray<5> > &) const;
+
       void canonicalize(int,const BTAS_SIDE &,bool);
 
+      void touch(int);
+
+      void touch();
+
+      unsigned long gversion(int) const;
+
+      double glog_norm() const;
+
+      void slog_norm(double);
+
    private:
 
       //!cutoff virtual dimension
       int D;
 
+      //!version stamp of every row, changes whenever the tensors on that row are modified
+      vector<unsigned long> version;
+
+      //!log of the norm which has been divided out of the tensors
+      double log_norm;
+
 };
 
 /**
@@ -1,6 +1,7 @@
 #ifndef RANDOM_H
 #define RANDOM_H
 
+#include <iostream>
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/normal_distribution.hpp>
 #include <boost/random/uniform_real_distribution.hpp>
@@ -23,6 +24,15 @@ class Random {
       //Draw OpenMP and MPI thread safe random numbers from the normal distribution (mean = 0, sigma = 1)
       double normal();
       
+      //Seed the generators of all threads deterministically, for reproducible runs
+      void seed(unsigned long);
+
+      //Write the state of the generators and distributions of all threads
+      void save(std::ostream &) const;
+
+      //Restore a state written by save
+      void load(std::istream &);
+
       //Tester of the Random number generator
       void test();
       
@@ -23,9 +23,20 @@ class Trotter {
 
    public:
 
+      //!a nonzero element (s,k,s_) of a split operator
+      struct Element {
+
+         int s;
+         int k;
+         int s_;
+
+         double value;
+
+      };
+
       Trotter();
 
-      Trotter(double tau);
+      Trotter(double tau,double tol = 1.0e-15);
 
       Trotter(const Trotter &);
 
@@ -33,13 +44,26 @@ class Trotter {
 
       double gtau() const;
 
+      double gtol() const;
+
       const DArray<3> &gLO_n() const;
       const DArray<3> &gRO_n() const;
       
       const DArray<3> &gLO_nn() const;
       const DArray<3> &gRO_nn() const;
 
+      const vector<Element> &gLO_n_nz() const;
+      const vector<Element> &gRO_n_nz() const;
+
+      const vector<Element> &gLO_nn_nz() const;
+      const vector<Element> &gRO_nn_nz() const;
+
+      double gerror_n() const;
+      double gerror_nn() const;
+
    private:
+
+      double split(const DArray<2> &,DArray<3> &,DArray<3> &,vector<Element> &,vector<Element> &) const;
       
       //!Nearest-neigbour Trotter Operators: Left and Right
       DArray<3> LO_n;
@@ -49,9 +73,23 @@ class Trotter {
       DArray<3> LO_nn;
       DArray<3> RO_nn;
 
+      //!their nonzero elements
+      vector<Element> LO_n_nz;
+      vector<Element> RO_n_nz;
+
+      vector<Element> LO_nn_nz;
+      vector<Element> RO_nn_nz;
+
+      //!relative errors of the splits
+      double error_n;
+      double error_nn;
+
       //!timestep
       double tau;
 
+      //!singular values of the gates below tol times the largest one are dropped
+      double tol;
+
 
 };
 
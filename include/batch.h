@@ -0,0 +1,61 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+
+using std::ostream;
+using std::vector;
+
+//run many parameter points in one launch: every job is a separate simulation context, a forked worker with its own share of the cores
+namespace batch {
+
+   //!a parameter point of a sweep, with the arguments of main and the file its energies are written to
+   struct Job {
+
+      //!lattice size, physical, virtual and auxiliary dimension
+      int L;
+      int d;
+      int D;
+      int D_aux;
+
+      //!next-nearest neighbour coupling in units of 0.1 J1, as for main
+      int J2;
+
+      //!exponent of the regularization constant
+      int noise;
+
+      //!time step and nr of imaginary time steps
+      double tau;
+      int steps;
+
+      //!output file of the job
+      std::string output;
+
+   };
+
+   //!what happened to a job
+   struct Result {
+
+      //!exit status of the worker, 0 on success
+      int status;
+
+      //!wall time of the job
+      double time;
+
+   };
+
+   vector<Job> read(const std::string &);
+
+   void run(const Job &);
+
+   vector<Result> launch(const vector<Job> &,int);
+
+   void print(ostream &,const vector<Job> &,const vector<Result> &);
+
+}
+
+#endif
+
+/* vim: set ts=3 sw=3 expandtab :*/
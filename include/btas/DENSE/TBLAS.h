@@ -221,6 +221,8 @@ void Gemm (
 
    if(a.size() == 0 || b.size() == 0) return;
 
+   BTAS_TRACE("Gemm");
+
    IVector<K> idxcon;
    IVector<N> shapeC;
    gemm_contract_shape(transa, transb, a.shape(), b.shape(), idxcon, shapeC);
@@ -243,6 +245,10 @@ void Gemm (
 
    blas::gemm(CblasRowMajor, transa, transb, rowsA, colsB, colsA, alpha, a.data(), ldA, b.data(), ldB, beta, c.data(), colsB);
 
+   BTAS_TRACE_ARG("a", a);
+   BTAS_TRACE_ARG("b", b);
+   BTAS_TRACE_ARG("c", c);
+
 }
 
 //  ====================================================================================================
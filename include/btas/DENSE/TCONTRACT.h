@@ -8,9 +8,22 @@
 #include <btas/DENSE/TBLAS.h>
 #include <btas/DENSE/TREINDEX.h>
 
+#ifdef _PROFILE
+#include <atomic>
+#endif
+
 namespace btas
 {
 
+#ifdef _PROFILE
+/// Nr. of floating point operations done by Contract, summed over all threads
+inline std::atomic<unsigned long long>& contract_flops ()
+{
+   static std::atomic<unsigned long long> n(0);
+   return n;
+}
+#endif
+
 /// Contract Arrays
 template<typename T, size_t L, size_t M, size_t K>
 void Contract (
@@ -20,6 +33,8 @@ void Contract (
       const T& beta,
             TArray<T, L+M-K-K>& c)
 {
+   BTAS_TRACE("Contract");
+
    IVector<L> reorderA;
    IVector<M> reorderB;
 
@@ -54,6 +69,17 @@ void Contract (
       transb = CblasNoTrans;
 
    BlasContract(transa, transb, alpha, a_ref, b_ref, beta, c);
+
+   BTAS_TRACE_ARG("a", a);
+   BTAS_TRACE_ARG("b", b);
+   BTAS_TRACE_ARG("c", c);
+
+#ifdef _PROFILE
+   // every element of c is an inner product over the contracted indices
+   unsigned long long inner = 1;
+   for(size_t i = 0; i < K; ++i) inner *= a.shape(contractA[i]);
+   contract_flops() += 2ULL * c.size() * inner;
+#endif
 }
 
 /// Contract Arrays by symbols
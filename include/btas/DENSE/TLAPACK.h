@@ -30,6 +30,8 @@ namespace btas
       {
          if(a.size() == 0) return;
 
+         BTAS_TRACE("Syev");
+
          const size_t K = N-1;
          BTAS_THROW(std::equal(a.shape().begin(), a.shape().begin()+K, a.shape().begin()+K), "Syev(DENSE): shape of a must be symmetric.");
 
@@ -45,6 +47,9 @@ namespace btas
          d.resize(colsA);
 
          lapack::syev(CblasRowMajor, jobz, uplo, colsA, z.data(), colsA, d.data());
+
+         BTAS_TRACE_ARG("a", a);
+         BTAS_TRACE_ARG("z", z);
       }
 
    /// Solve hermitian eigenvalue problem (HEP)
@@ -88,6 +93,8 @@ namespace btas
       {
          if(a.size() == 0) return;
 
+         BTAS_TRACE("Gesvd");
+
          const IVector<M>& shapeA = a.shape();
 
          size_t rowsA = std::accumulate(shapeA.begin(), shapeA.begin()+N-1, 1ul, std::multiplies<size_t>());
@@ -121,6 +128,10 @@ namespace btas
 
          TArray<T, M> acp(a);
          lapack::gesvd(CblasRowMajor, jobu, jobvt, rowsA, colsA, acp.data(), ldA, s.data(), u.data(), ldU, vt.data(), ldVt);
+
+         BTAS_TRACE_ARG("a", a);
+         BTAS_TRACE_ARG("u", u);
+         BTAS_TRACE_ARG("vt", vt);
       }
 
    /// Solve singular value decomposition (SVD): compressing
@@ -233,6 +244,8 @@ namespace btas
          if(A.size() == 0)
             return;
 
+         BTAS_TRACE("Geqrf");
+
          size_t K = M - N/2;//number of row legs
          size_t L = N/2;//number of col leg
 
@@ -269,6 +282,9 @@ namespace btas
 
          delete [] tau;
 
+         BTAS_TRACE_ARG("A", A);
+         BTAS_TRACE_ARG("R", R);
+
       }
 
    /** perform a LQ decomposition
@@ -284,6 +300,8 @@ namespace btas
          if(A.size() == 0)
             return;
 
+         BTAS_TRACE("Gelqf");
+
          size_t I = M/2;//number of row leg
          size_t J = N - M/2;//number of col legs
 
@@ -320,6 +338,9 @@ namespace btas
 
          delete [] tau;
 
+         BTAS_TRACE_ARG("L", L);
+         BTAS_TRACE_ARG("A", A);
+
       }
 
 } // namespace btas
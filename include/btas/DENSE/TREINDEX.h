@@ -18,6 +18,8 @@ void Permute (const TArray<T, N>& x, const IVector<N>& reorder, TArray<T, N>& y)
 {
    if(x.size() == 0) return;
 
+   BTAS_TRACE("Permute");
+
    IVector<N> storder = reorder;
    std::sort(storder.begin(), storder.end());
 
@@ -35,6 +37,9 @@ void Permute (const TArray<T, N>& x, const IVector<N>& reorder, TArray<T, N>& y)
 
       reindex<T, N, CblasRowMajor>(x.data(), y.data(), permute(x.stride(), reorder), y.shape());
    }
+
+   BTAS_TRACE_ARG("x", x);
+   BTAS_TRACE_ARG("y", y);
 }
 
 //! Indexed permutation for double precision real dense array
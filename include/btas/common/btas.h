@@ -26,6 +26,8 @@
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/complex.hpp>
 
+#include <btas/common/btas_trace.h>
+
 namespace btas {
 
 typedef unsigned int  uint;
@@ -0,0 +1,94 @@
+#ifndef __BTAS_COMMON_TRACE_H
+#define __BTAS_COMMON_TRACE_H 1
+
+// Timeline of the dense kernels: with _PROFILE every traced call is handed to the tracer, if one is set.
+// Without _PROFILE the macros are empty.
+
+#ifdef _PROFILE
+
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <algorithm>
+
+namespace btas
+{
+
+template<typename T, size_t N> class TArray;
+
+/// Receives a traced call: name, start, end, shapes of the arguments and nr. of bytes of the arguments
+typedef void (*trace_sink) (const char*, std::chrono::steady_clock::time_point, std::chrono::steady_clock::time_point, const std::string&, double);
+
+/// The tracer, 0 if calls are not traced
+inline trace_sink& tracer ()
+{
+   static trace_sink sink = 0;
+   return sink;
+}
+
+/// Times a call from construction to destruction and hands it to the tracer.
+/// Without a tracer nothing is formatted or allocated: the shapes are written to a fixed buffer only when the call is traced.
+class Traced
+{
+public:
+   Traced (const char* name) : name_(name), on_(tracer() != 0), len_(0), bytes_(0.0)
+   {
+      if(on_) start_ = std::chrono::steady_clock::now();
+   }
+
+   ~Traced ()
+   {
+      if(on_ && tracer()) tracer()(name_, start_, std::chrono::steady_clock::now(), std::string(args_, len_), bytes_);
+   }
+
+   /// Add an argument: its shape is described and its size counted
+   template<typename T, size_t N>
+   void arg (const char* label, const TArray<T, N>& x)
+   {
+      if(!on_) return;
+
+      bytes_ += x.size() * sizeof(T);
+
+      put(len_ ? " %s[" : "%s[", label);
+      for(size_t i = 0; i < N; ++i) put(i ? ",%d" : "%d", x.shape(i));
+      put("]", 0);
+   }
+
+private:
+   /// Append to the buffer, a description that does not fit is cut off
+   template<typename V>
+   void put (const char* format, V value)
+   {
+      if(len_ >= sizeof(args_) - 1) return;
+
+      int n = std::snprintf(args_ + len_, sizeof(args_) - len_, format, value);
+
+      if(n > 0) len_ = std::min(len_ + n, sizeof(args_) - 1);
+   }
+
+   const char* name_;
+
+   bool on_;
+
+   std::chrono::steady_clock::time_point start_;
+
+   char args_[128];
+
+   size_t len_;
+
+   double bytes_;
+};
+
+} // namespace btas
+
+#define BTAS_TRACE(name) btas::Traced btas_traced(name)
+#define BTAS_TRACE_ARG(label, x) btas_traced.arg(label, x)
+
+#else
+
+#define BTAS_TRACE(name)
+#define BTAS_TRACE_ARG(label, x)
+
+#endif
+
+#endif // __BTAS_COMMON_TRACE_H
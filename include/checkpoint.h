@@ -0,0 +1,217 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <complex>
+#include <cstring>
+#include <functional>
+#include <stdint.h>
+
+#include <btas/common/blas_cxx_interface.h>
+#include <btas/common/TVector.h>
+#include <btas/DENSE/TArray.h>
+
+using std::vector;
+
+using namespace btas;
+
+template<typename T>
+class PEPS;
+
+//binary checkpoint files: blocks of a fixed header, a table and the raw data, written in one go and read back through mmap
+namespace checkpoint {
+
+   //!current version of the binary format
+   const uint32_t VERSION = 3;
+
+   //!data types of the stored tensors
+   enum DTYPE {
+
+      //!double precision real
+      REAL=0,
+
+      //!double precision complex
+      COMPLEX=1
+
+   };
+
+   //!header of a PEPS block: followed by Lx*Ly site records and the tensor data
+   struct Header {
+
+      //!"PEPSBIN" + '\0'
+      char magic[8];
+
+      //!format version
+      uint32_t version;
+
+      //!DTYPE of the elements
+      uint32_t dtype;
+
+      //!dimensions of the lattice, physical and virtual dimension
+      int32_t Lx;
+      int32_t Ly;
+      int32_t d;
+      int32_t D;
+
+      //!offset of the tensor data, relative to the start of the block
+      uint64_t data;
+
+      //!nr of bytes of tensor data
+      uint64_t bytes;
+
+      //!checksum of the block: the header with this field at zero, the site table and the tensor data
+      uint64_t checksum;
+
+   };
+
+   //!header of a full simulation state: followed by the random generator state, the energy history, a PEPS block and an Environment block
+   struct State {
+
+      //!"PEPSSTA" + '\0'
+      char magic[8];
+
+      //!format version
+      uint32_t version;
+
+      //!index of the next imaginary time step
+      int32_t step;
+
+      //!time step of the Trotter decomposition
+      double tau;
+
+      //!global parameters
+      int32_t Lx;
+      int32_t Ly;
+      int32_t d;
+      int32_t D;
+      int32_t D_aux;
+      int32_t comp_sweeps;
+
+      double J2;
+      double scal_num;
+      double reg_const;
+
+      //!log of the norm divided out of the peps tensors, see PEPS::glog_norm
+      double log_norm;
+
+      //!nr of bytes after the header
+      uint64_t bytes;
+
+      //!checksum of the bytes after the header
+      uint64_t checksum;
+
+   };
+
+   //!shape of a site tensor and offset of its elements, relative to the start of the tensor data
+   struct Site {
+
+      int64_t shape[5];
+
+      uint64_t offset;
+
+   };
+
+   template<typename T>
+      uint32_t dtype();
+
+   template<>
+      uint32_t dtype<double>();
+
+   template<>
+      uint32_t dtype< std::complex<double> >();
+
+   uint64_t checksum(const char *,size_t,uint64_t = 14695981039346656037ULL);
+
+   /**
+    * append a trivially copyable object to a buffer
+    * @param buffer the buffer to which is appended
+    * @param obj the object
+    */
+   template<typename T>
+      void put(vector<char> &buffer,const T &obj){
+
+         const char *ptr = reinterpret_cast<const char *>(&obj);
+         buffer.insert(buffer.end(),ptr,ptr + sizeof(T));
+
+      }
+
+   /**
+    * read a trivially copyable object from memory and move on
+    * @param ptr input: position to read from, output: position after the object
+    * @param obj output: the object
+    */
+   template<typename T>
+      void get(const char *&ptr,T &obj){
+
+         memcpy(&obj,ptr,sizeof(T));
+         ptr += sizeof(T);
+
+      }
+
+   /**
+    * append a tensor to a buffer: its shape followed by the elements
+    * @param buffer the buffer to which is appended
+    * @param A the tensor
+    */
+   template<typename T,size_t N>
+      void put(vector<char> &buffer,const TArray<T,N> &A){
+
+         for(size_t i = 0;i < N;++i)
+            put(buffer,(int64_t)A.shape(i));
+
+         const char *ptr = reinterpret_cast<const char *>(A.data());
+         buffer.insert(buffer.end(),ptr,ptr + A.size() * sizeof(T));
+
+      }
+
+   /**
+    * read a tensor written by put and move on
+    * @param ptr input: position to read from, output: position after the tensor
+    * @param A output: the tensor, resized
+    */
+   template<typename T,size_t N>
+      void get(const char *&ptr,TArray<T,N> &A){
+
+         IVector<N> shape;
+
+         for(size_t i = 0;i < N;++i){
+
+            int64_t dim;
+            get(ptr,dim);
+
+            shape[i] = dim;
+
+         }
+
+         A.resize(shape);
+
+         memcpy(A.data(),ptr,A.size() * sizeof(T));
+         ptr += A.size() * sizeof(T);
+
+      }
+
+   void write(const std::string &,const vector<char> &);
+
+   const char *map(const std::string &,size_t &);
+
+   void unmap(const char *,size_t);
+
+   bool is_directory(const std::string &);
+
+   vector<char> *stage();
+
+   void submit(const std::string &,vector<char> *,std::function<void(vector<char> &)>);
+
+   void save_state(const std::string &,int,const PEPS<double> &,const vector<double> &);
+
+   int load_state(const std::string &,PEPS<double> &,vector<double> &);
+
+   void wait();
+
+}
+
+#endif
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -25,6 +25,44 @@ namespace contractions {
 
    void update_L(int row,int col,const PEPS<double> &,DArray<6> &LO);
 
+   void apply_stack(const DArray<3> &,const DArray<5> &,DArray<6> &);
+
+   /**
+    * start a stacked chain: contract K legs of an ordinary intermediate with the first K virtual/physical legs of a stack of operated peps
+    * tensors. The operator index becomes the leading leg of the output, followed by the free legs of X and the free legs of the peps.
+    * @param X the intermediate
+    * @param legs the legs of X which are contracted
+    * @param peps_op stack of operated peps tensors (i,left,up,phys,down,right), see apply_stack
+    * @param out output: the stacked intermediate
+    */
+   template<size_t N,size_t K,size_t M>
+      void open_stack(const DArray<N> &X,const IVector<K> &legs,const DArray<6> &peps_op,DArray<M> &out){
+
+         IVector<K> op_legs;
+
+         for(size_t k = 0;k < K;++k)
+            op_legs[k] = k + 1;
+
+         //free legs of X, operator index, free legs of the peps
+         DArray<M> tmp;
+         Contract(1.0,X,legs,peps_op,op_legs,0.0,tmp);
+
+         //move the operator index to the front
+         IVector<M> perm;
+
+         perm[0] = N - K;
+
+         for(size_t k = 0;k < N - K;++k)
+            perm[k + 1] = k;
+
+         for(size_t k = N - K + 1;k < M;++k)
+            perm[k] = k;
+
+         out.clear();
+         Permute(tmp,perm,out);
+
+      }
+
 }
 
 #endif
@@ -0,0 +1,97 @@
+#ifndef FOOTPRINT_H
+#define FOOTPRINT_H
+
+#include <iostream>
+#include <string>
+
+using std::ostream;
+
+//memory accounting of the heap (which holds the storage of every TArray): current and peak use, the transient peak of tagged call sites and
+//a budget above which allocations are refused, compiled in with -D_FOOTPRINT (e.g. make DEFS=-D_FOOTPRINT) because it replaces the global
+//operator new and delete. The planner, which predicts the peak of a run from its dimensions, is always there.
+#ifdef _FOOTPRINT
+
+#define FOOTPRINT_CONCAT_(a,b) a##b
+#define FOOTPRINT_CONCAT(a,b) FOOTPRINT_CONCAT_(a,b)
+
+//!record the peak heap memory the rest of the enclosing block allocates on top of what this thread held when it started, under 'name'
+#define FOOTPRINT_TAG(name) footprint::Tag FOOTPRINT_CONCAT(footprint_tag_,__LINE__)(name)
+
+#else
+
+#define FOOTPRINT_TAG(name)
+
+#endif
+
+namespace footprint {
+
+   /**
+    * a call site, from its construction until the end of the enclosing block: the largest amount of memory the block allocated
+    * on its thread on top of what was there when it started is recorded under its name. Tags may be nested.
+    */
+   class Tag {
+
+      public:
+
+         Tag(const char *);
+
+         //destructor
+         ~Tag();
+
+      private:
+
+         //!name of the call site
+         const char *name;
+
+         //!net nr of bytes allocated by the thread when the tag started
+         long long entry;
+
+         //!high-water mark of the enclosing tag, restored when this one ends
+         long long outer;
+
+   };
+
+   //!predicted memory of a run, in bytes
+   struct Plan {
+
+      //!OpenMP threads and nr of environment layers kept in memory (0 all) the prediction is made for
+      int threads;
+      int capacity;
+
+      //!the PEPS and the boundary 'MPO' layers of the environment
+      double peps;
+      double layers;
+
+      //!transient peaks of a single update of propagate::step, of PEPS::energy and of a layer of the environment, for a single thread
+      double step;
+      double energy;
+      double environment;
+
+      //!predicted peak of the run
+      double peak;
+
+   };
+
+   double current();
+
+   double peak();
+
+   void reset_peak();
+
+   void sbudget(double);
+
+   double gbudget();
+
+   void report(ostream &);
+
+   Plan estimate(int,int,int,int,int,int,int,int);
+
+   Plan fit(int,int,int,int,int,int,int,int,double);
+
+   void print(ostream &,const Plan &);
+
+}
+
+#endif
+
+/* vim: set ts=3 sw=3 expandtab :*/
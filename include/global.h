@@ -68,6 +68,9 @@ namespace global {
 
    //!set the timestep
    void stau(double);
+
+   //!set the tolerance of the split of the gates
+   void stol(double);
    
    void sD(int);
 
@@ -7,6 +7,10 @@
 
 #include "Random.h"
 
+#include "profile.h"
+#include "footprint.h"
+#include "telemetry.h"
+
 #include "Hamiltonian.h"
 
 #include "global.h"
@@ -15,11 +19,18 @@
 #include "MPS.h"
 #include "MPO.h"
 
+#include "CTMRG.h"
+#include "MPOStore.h"
 #include "Environment.h"
 
 #include "contractions.h"
+#include "Measurement.h"
 
 #include "Trotter.h"
 #include "propagate.h"
+#include "schedule.h"
+#include "batch.h"
+
+#include "checkpoint.h"
 
 #include "debug.h"
@@ -0,0 +1,79 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <iostream>
+#include <string>
+#include <chrono>
+
+using std::ostream;
+
+//scoped timers, flop counters and a Chrome trace of the dense kernels, compiled in with -D_PROFILE (e.g. make DEFS=-D_PROFILE), otherwise the macros are empty
+#ifdef _PROFILE
+
+#define PROFILE_CONCAT_(a,b) a##b
+#define PROFILE_CONCAT(a,b) PROFILE_CONCAT_(a,b)
+
+//!time the rest of the enclosing block under 'name', nested in the scopes which are open on this thread
+#define PROFILE_SCOPE(name) profile::Scope PROFILE_CONCAT(profile_scope_,__LINE__)(name)
+
+//!add flops which are not done by btas::Contract (e.g. LAPACK calls) to the open scopes
+#define PROFILE_FLOPS(n) profile::flops(n)
+
+//!print the table of everything timed since the last report, and start over
+#define PROFILE_REPORT(out) profile::report(out)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_FLOPS(n)
+#define PROFILE_REPORT(out)
+
+#endif
+
+namespace profile {
+
+   /**
+    * a timer which runs from its construction until the end of the enclosing block. Scopes opened while it runs are nested in it: the
+    * time and flops of a scope are recorded under the path of the names of all the scopes which are open on its thread.
+    */
+   class Scope {
+
+      public:
+
+         Scope(const char *);
+
+         //destructor
+         ~Scope();
+
+      private:
+
+         //!start of the scope
+         std::chrono::steady_clock::time_point start;
+
+         //!flops counted before the scope started
+         double flops;
+
+         //!name of the scope, for the trace
+         const char *name;
+
+   };
+
+   void flops(double);
+
+   double count();
+
+   const char *label(int,int);
+
+   void report(ostream &);
+
+   void reset();
+
+   void trace(const std::string &);
+
+   void trace_end();
+
+}
+
+#endif
+
+/* vim: set ts=3 sw=3 expandtab :*/
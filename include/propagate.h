@@ -29,7 +29,7 @@ namespace propagate {
    
    };
 
-   void step(PEPS<double> &,int);
+   double step(PEPS<double> &,int,bool energy = false);
 
    void solve(DArray<8> &,DArray<5> &);
 
@@ -77,6 +77,9 @@ namespace propagate {
 
             const DArray<M> &,const DArray<M> &,const DArray<M+2> &,const DArray<M+2> &,const DArray<M+2> &,const DArray<M+2> &,bool);
 
+   //act with a split trotter operator on a site, using its nonzero elements
+   void apply(const DArray<5> &,const DArray<3> &,const vector<Trotter::Element> &,DArray<6> &);
+
    //initialization by SVD
    void initialize(const PROP_DIR &,int,int,const DArray<6> &,const DArray<6> &,PEPS<double> &);
 
@@ -94,7 +97,7 @@ namespace propagate {
 
    void shift_col(char,int,int,PEPS<double> &);
 
-   void shift_row(char option,int,PEPS<double> &);
+   void shift_row(char option,int,PEPS<double> &,vector< DArray<2> > *R = 0);
 
    void regularize(DArray<8> &N_eff,double);
 
@@ -0,0 +1,71 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include <btas/common/blas_cxx_interface.h>
+#include <btas/common/TVector.h>
+#include <btas/DENSE/TArray.h>
+
+using std::ostream;
+using std::vector;
+
+using namespace btas;
+
+template<typename T>
+class PEPS;
+
+//driver of the imaginary time evolution: single steps with their energy, and a ramp of the bond dimension in stages
+namespace schedule {
+
+   //!a stage of the ramp: the bond dimensions, and when to move on to the next stage
+   struct Stage {
+
+      //!virtual and auxiliary bond dimension
+      int D;
+      int D_aux;
+
+      //!converged when the energy changes less than this in a single step
+      double tol;
+
+      //!maximal nr of steps in the stage
+      int max_steps;
+
+   };
+
+   //!what happened in a stage of the ramp
+   struct Report {
+
+      int D;
+      int D_aux;
+
+      //!nr of steps done in the stage, and whether the energy converged before max_steps
+      int steps;
+      bool converged;
+
+      //!energy at the end of the stage
+      double energy;
+
+      //!wall time of the stage, and of the ramp up to the end of the stage
+      double time;
+      double total;
+
+   };
+
+   double step(PEPS<double> &,int,char,bool);
+
+   vector<Stage> parse(const std::string &);
+
+   double grow(PEPS<double> &,int,int,double,double,double);
+
+   vector<Report> ramp(PEPS<double> &,const vector<Stage> &,double,char,int,vector<double> &);
+
+   void print(ostream &,const vector<Report> &);
+
+}
+
+#endif
+
+/* vim: set ts=3 sw=3 expandtab :*/
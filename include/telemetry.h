@@ -0,0 +1,25 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <string>
+
+//machine readable metrics of a run: one JSON object per time step, appended to a file by a background thread
+namespace telemetry {
+
+   void open(const std::string &);
+
+   void close();
+
+   bool active();
+
+   void add(const char *,double);
+
+   void maximum(const char *,double);
+
+   void emit(int,double,double);
+
+}
+
+#endif
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -12,6 +12,12 @@
 #include <cmath>
 #include <vector>
 #include <complex>
+#include <string>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using std::cout;
 using std::endl;
@@ -27,6 +33,18 @@ int main(int argc,char *argv[]){
 
    cout.precision(15);
 
+   //batch mode: a job file and the nr of jobs which run at the same time (default 1), see batch::read
+   if(argc == 2 || argc == 3){
+
+      vector<batch::Job> jobs = batch::read(argv[1]);
+      vector<batch::Result> results = batch::launch(jobs,(argc > 2) ? atoi(argv[2]) : 1);
+
+      batch::print(cout,jobs,results);
+
+      return 0;
+
+   }
+
    int L = atoi(argv[1]);//dimension of the lattice: LxL
    int d = atoi(argv[2]);//physical dimension
    int D = atoi(argv[3]);//virtual dimension
@@ -40,38 +58,190 @@ int main(int argc,char *argv[]){
    //initialize some statics dimensions
    global::init(D,D_aux,d,L,L,J2,tau,noise);
 
+   //the optional arguments, after the six above: in this order, or in any order by name as --name=value. An empty one or "-" is left
+   //at its default, so a later one can be given by position without the ones in between
+   const int n_options = 13;
+
+   const char *names[n_options] = {"method","capacity","dir","init","state","interval","measure","anchor","ramp","trace","budget","telemetry",
+
+      "gate_tol"};
+
+   vector<std::string> option(n_options);
+
+   int position = 0;
+
+   for(int i = 7;i < argc;++i){
+
+      std::string arg = argv[i];
+
+      int k = position;
+
+      if(arg.compare(0,2,"--") == 0){
+
+         size_t equal = arg.find('=');
+
+         for(k = 0;k < n_options;++k)
+            if(equal != std::string::npos && arg.compare(2,equal - 2,names[k]) == 0)
+               break;
+
+         arg = (k < n_options) ? arg.substr(equal + 1) : "";
+
+      }
+      else
+         ++position;
+
+      //not BTAS_THROW: this has to be checked in optimized builds as well
+      if(k >= n_options)
+         throw std::runtime_error("main: argument '" + std::string(argv[i]) + "' is not an option, see main.cpp for their names and order");
+
+      option[k] = (arg == "-") ? "" : arg;
+
+   }
+
+   //method: contraction method of the environment, 'M' boundary MPO compression (default) or 'C' CTMRG
+   if(option[0] != "")
+      global::env.smethod(option[0][0]);
+
+   //capacity, dir: keep at most this many environment layers in memory, the others go to a scratch file in the directory dir (default .)
+   if(option[1] != "")
+      global::env.sstore(atoi(option[1].c_str()),(option[2] != "") ? option[2] : ".");
+
+   //init: initial guess of the compressed layers, 'S' svd (default), 'Z' zip-up with randomized QR or 'P' previous layer
+   if(option[3] != "")
+      global::env.sinit(option[3][0]);
+
+   //state, interval: checkpoint file of the complete state, written every interval (default 100) steps. The run is resumed from it if it exists
+   std::string state = option[4];
+   int interval = (option[5] != "") ? atoi(option[5].c_str()) : 100;
+
+   //measure: energy of every step, 'F' full contraction after the step (default) or 'S' the energy before the step, from its environment
+   char measure = (option[6] != "") ? option[6][0] : 'F';
+
+   //anchor: the state is normalized every anchor (default 1) steps, in between its norm is only tracked in PEPS::glog_norm
+   int anchor = (option[7] != "") ? atoi(option[7].c_str()) : 1;
+
+   //ramp: ramp of the bond dimension "D:D_aux[:tol[:max_steps]],...", started from the D = 2 Jastrow state before the run at the last stage
+   std::string ramp = option[8];
+
+   //trace, with -D_PROFILE: Chrome trace of the first step of the run, written to this file
+   std::string trace = option[9];
+
+   //budget: memory budget in GB: the run is fitted into it by footprint::fit (fewer threads, layers out of core) or refused, with -D_FOOTPRINT
+   //allocations above it fail
+   double budget = (option[10] != "") ? 1.0e9 * atof(option[10].c_str()) : 0.0;
+
+   if(budget > 0.0){
+
+#ifdef _OPENMP
+      int threads = omp_get_max_threads();
+#else
+      int threads = 1;
+#endif
+
+      footprint::Plan plan = footprint::fit(L,L,d,D,D_aux,threads,global::env.gblocks(),global::env.gstore().gcapacity(),budget);
+      footprint::print(cout,plan);
+
+#ifdef _OPENMP
+      omp_set_num_threads(plan.threads);
+#endif
+
+      if(plan.capacity != global::env.gstore().gcapacity())
+         global::env.sstore(plan.capacity,(global::env.gstore().gdir() != "") ? global::env.gstore().gdir() : ".");
+
+      footprint::sbudget(budget);
+
+   }
+
+   //telemetry: telemetry of every step (times, ALS and truncation errors, norm, heap, utilization), appended as JSON lines to this file
+   if(option[11] != "")
+      telemetry::open(option[11]);
+
+   //gate_tol: relative tolerance of the split of the gates (default 1e-15): a lower rank makes the update cheaper, at the cost of the printed error.
+   //Only useful for gates with non-degenerate singular values: degenerate ones are kept together, so the Heisenberg gates of this model keep
+   //rank 4 for every tolerance (one which would leave rank 1 is refused)
+   if(option[12] != ""){
+
+      global::stol(atof(option[12].c_str()));
+
+      cout << "gate rank\t" << global::trot.gLO_n().shape(1) << "\t" << global::trot.gLO_nn().shape(1) << endl;
+      cout << "gate error\t" << global::trot.gerror_n() << "\t" << global::trot.gerror_nn() << endl;
+
+   }
+
    PEPS<double> peps(D);
-   peps.initialize_jastrow(0.74);
-   peps.normalize();
 
-   peps.rescale_tensors(global::scal_num);
-   peps.normalize();
+   vector<double> energy;
+   int start = 0;
 
-   for(int i = 0;i < 1000;++i){
+   if(state != "" && std::ifstream(state.c_str()).good())
+      start = checkpoint::load_state(state,peps,energy);
+   else{
+
+      peps.initialize_jastrow(0.74);
+
+      //the Jastrow state has D = 2: the ramp grows it, starting at D = 2
+      if(ramp != "")
+         global::sD(peps.gD());
+
+      peps.normalize();
 
-      propagate::step(peps,10);
       peps.rescale_tensors(global::scal_num);
       peps.normalize();
 
-      global::env.calc('A',peps); 
-      cout << i << "\t" << peps.energy() << endl;
+      if(ramp != ""){
+
+         vector<schedule::Report> reports = schedule::ramp(peps,schedule::parse(ramp),1.0e-3,measure,anchor,energy);
+         schedule::print(cout,reports);
+
+         start = energy.size();
+
+      }
 
    }
 
-   tau *= 0.1;
-   global::stau(tau);
+   for(int i = start;i < 5000;++i){
 
-   for(int i = 1000;i < 5000;++i){
+      //smaller time step after the first 1000 steps
+      if(i == 1000){
 
-      propagate::step(peps,10);
-      peps.rescale_tensors(global::scal_num);
-      peps.normalize();
+         tau = 0.1 * global::trot.gtau();
+         global::stau(tau);
+
+      }
+
+      if(trace != "" && i == start)
+         profile::trace(trace);
+
+      energy.push_back(schedule::step(peps,i,measure,(i + 1) % anchor == 0));
+
+      if(trace != "" && i == start)
+         profile::trace_end();
 
-      global::env.calc('A',peps); 
-      cout << i << "\t" << peps.energy() << endl;
+      cout << i << "\t" << energy.back() << endl;
+
+      if(state != "" && (i + 1) % interval == 0)
+         checkpoint::save_state(state,i + 1,peps,energy);
 
    }
 
+   checkpoint::wait();
+
+   telemetry::close();
+
+   //observables of the final state, all from a single environment
+   Measurement meas;
+
+   meas.dimers();
+   meas.correlations();
+
+   meas.measure(peps);
+   meas.print(cout);
+
+   cout << "S(pi,pi)\t" << meas.structure_factor(M_PI,M_PI) << endl;
+
+   if(budget > 0.0)
+      footprint::report(cout);
+
    return 0;
 
 }
@@ -0,0 +1,391 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <fstream>
+#include <stdexcept>
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+#include "include.h"
+
+namespace profile {
+
+   //!what has been recorded under a path
+   struct Entry {
+
+      long calls;
+
+      double time;
+
+      double flops;
+
+   };
+
+   //!separator of the names in a path: it sorts before every character of a name, so that every path is followed by the paths nested in it
+   static const char SEP = '\1';
+
+   //!the recorded paths
+   static std::map<std::string,Entry> entries;
+
+   //!protects entries
+   static std::mutex lock;
+
+   //!paths of the open scopes of every thread, innermost last
+   static thread_local vector<std::string> open;
+
+   //!a call or scope on the timeline
+   struct Event {
+
+      const char *name;
+
+      //!'kernel' for the btas calls, 'phase' for the scopes
+      const char *cat;
+
+      int tid;
+
+      //!start and duration in microseconds since the start of the trace
+      double ts;
+      double dur;
+
+      //!shapes and bytes of the arguments of a kernel
+      std::string args;
+      double bytes;
+
+   };
+
+   //!true while a trace is recorded, its file, start and events
+   static std::atomic<bool> tracing(false);
+   static std::string trace_file;
+   static std::chrono::steady_clock::time_point origin;
+   static vector<Event> events;
+
+   //!small ids of the threads, in the order in which they first show up in the trace
+   static std::atomic<int> threads(0);
+   static thread_local int tid = -1;
+
+   /**
+    * add an event to the trace
+    * @param name name of the call or scope
+    * @param cat category of the event
+    * @param start start of the event
+    * @param end end of the event
+    * @param args shapes of the arguments, empty for a scope
+    * @param bytes nr of bytes of the arguments
+    */
+   static void record(const char *name,const char *cat,std::chrono::steady_clock::time_point start,std::chrono::steady_clock::time_point end,
+
+         const std::string &args,double bytes){
+
+      if(tid == -1)
+         tid = threads++;
+
+      Event event;
+
+      event.name = name;
+      event.cat = cat;
+      event.tid = tid;
+
+      event.ts = std::chrono::duration<double,std::micro>(start - origin).count();
+      event.dur = std::chrono::duration<double,std::micro>(end - start).count();
+
+      event.args = args;
+      event.bytes = bytes;
+
+      std::lock_guard<std::mutex> guard(lock);
+
+      if(tracing)
+         events.push_back(event);
+
+   }
+
+#ifdef _PROFILE
+   /**
+    * the tracer handed to btas: the dense kernels
+    */
+   static void kernel(const char *name,std::chrono::steady_clock::time_point start,std::chrono::steady_clock::time_point end,const std::string &args,double bytes){
+
+      record(name,"kernel",start,end,args,bytes);
+
+   }
+#endif
+
+   /**
+    * start a scope
+    * @param name_in name of the scope, it is recorded under the path of the scopes which are open on this thread followed by name
+    */
+   Scope::Scope(const char *name_in){
+
+      name = name_in;
+
+      if(open.empty())
+         open.push_back(name);
+      else
+         open.push_back(open.back() + SEP + name);
+
+      flops = count();
+
+      start = std::chrono::steady_clock::now();
+
+   }
+
+   /**
+    * the scope ends: its time and the flops done since it started are added to its path
+    */
+   Scope::~Scope(){
+
+      std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+      double time = std::chrono::duration<double>(end - start).count();
+
+      double done = count() - flops;
+
+      {
+         std::lock_guard<std::mutex> guard(lock);
+
+         Entry &entry = entries[open.back()];
+
+         entry.calls++;
+         entry.time += time;
+         entry.flops += done;
+      }
+
+      open.pop_back();
+
+      if(tracing)
+         record(name,"phase",start,end,"",0.0);
+
+   }
+
+   /**
+    * count flops which are not done by btas::Contract
+    * @param n nr of flops
+    */
+   void flops(double n){
+
+#ifdef _PROFILE
+      btas::contract_flops() += (unsigned long long) n;
+#endif
+
+   }
+
+   /**
+    * @return the nr of flops counted since the start of the program on all threads: the Contract calls, estimated from their shapes,
+    * and the flops added with flops()
+    */
+   double count(){
+
+#ifdef _PROFILE
+      return (double) btas::contract_flops();
+#else
+      return 0.0;
+#endif
+
+   }
+
+   /**
+    * name of an update scope: the direction of the update and the type of the row it acts on
+    * @param dir propagate::PROP_DIR of the update
+    * @param row row index of the bottom site of the update
+    * @return e.g. "VERTICAL bottom"
+    */
+   const char *label(int dir,int row){
+
+      static const char *names[4][3] = {
+
+         {"VERTICAL bottom","VERTICAL middle","VERTICAL top"},
+         {"HORIZONTAL bottom","HORIZONTAL middle","HORIZONTAL top"},
+         {"DIAGONAL_LURD bottom","DIAGONAL_LURD middle","DIAGONAL_LURD top"},
+         {"DIAGONAL_LDRU bottom","DIAGONAL_LDRU middle","DIAGONAL_LDRU top"}
+
+      };
+
+      if(row == 0)
+         return names[dir][0];
+      else if(row >= global::Ly - 2)
+         return names[dir][2];
+      else
+         return names[dir][1];
+
+   }
+
+   /**
+    * print everything which has been recorded since the last report and start over. The first table lists every path, indented by its depth,
+    * with the fraction of the time of the outermost scope it is nested in. The second one sums the time of every stage name over all the paths
+    * it occurs in. The flops are inclusive: those of a scope include those of the scopes nested in it.
+    * @param out the stream to print to
+    */
+   void report(ostream &out){
+
+      std::lock_guard<std::mutex> guard(lock);
+
+      if(entries.empty())
+         return;
+
+      std::ios::fmtflags flags = out.flags();
+      std::streamsize precision = out.precision();
+
+      out << std::fixed << std::setprecision(3);
+
+      out << endl;
+      out << std::left << std::setw(52) << "#scope" << std::right << std::setw(10) << "calls" << std::setw(12) << "time (s)" << std::setw(10) << "%"
+
+         << std::setw(12) << "GFlop" << std::setw(12) << "GFlop/s" << endl;
+
+      //time of the outermost scope the current path is nested in, and of all the outermost scopes together
+      double total = 0.0;
+      double roots = 0.0;
+
+      //time per stage name
+      std::map<std::string,Entry> stages;
+
+      for(std::map<std::string,Entry>::const_iterator it = entries.begin();it != entries.end();++it){
+
+         const std::string &path = it->first;
+         const Entry &entry = it->second;
+
+         size_t slash = path.rfind(SEP);
+
+         int depth = 0;
+
+         for(size_t c = 0;c < path.size();++c)
+            if(path[c] == SEP)
+               ++depth;
+
+         if(depth == 0){
+
+            total = entry.time;
+            roots += entry.time;
+
+         }
+
+         std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+
+         Entry &stage = stages[name];
+
+         stage.calls += entry.calls;
+         stage.time += entry.time;
+         stage.flops += entry.flops;
+
+         out << std::left << std::setw(52) << std::string(2*depth,' ') + name << std::right << std::setw(10) << entry.calls << std::setw(12) << entry.time
+
+            << std::setw(10) << ((total > 0.0) ? 100.0 * entry.time / total : 0.0) << std::setw(12) << 1.0e-9 * entry.flops
+
+            << std::setw(12) << ((entry.time > 0.0) ? 1.0e-9 * entry.flops / entry.time : 0.0) << endl;
+
+      }
+
+      out << endl;
+      out << std::left << std::setw(52) << "#stage" << std::right << std::setw(10) << "calls" << std::setw(12) << "time (s)" << std::setw(10) << "%"
+
+         << std::setw(12) << "GFlop" << std::setw(12) << "GFlop/s" << endl;
+
+      for(std::map<std::string,Entry>::const_iterator it = stages.begin();it != stages.end();++it){
+
+         const Entry &entry = it->second;
+
+         out << std::left << std::setw(52) << it->first << std::right << std::setw(10) << entry.calls << std::setw(12) << entry.time
+
+            << std::setw(10) << ((roots > 0.0) ? 100.0 * entry.time / roots : 0.0) << std::setw(12) << 1.0e-9 * entry.flops
+
+            << std::setw(12) << ((entry.time > 0.0) ? 1.0e-9 * entry.flops / entry.time : 0.0) << endl;
+
+      }
+
+      out << endl;
+
+      out.flags(flags);
+      out.precision(precision);
+
+      entries.clear();
+
+   }
+
+   /**
+    * forget everything which has been recorded
+    */
+   void reset(){
+
+      std::lock_guard<std::mutex> guard(lock);
+
+      entries.clear();
+
+   }
+
+   /**
+    * start recording a trace: the scopes and, with -D_PROFILE, the btas kernels (Contract, Permute, Gemm, Gesvd, Geqrf, Gelqf, Syev) with
+    * their thread, the shapes of their arguments and the nr of bytes of the arguments
+    * @param filename the file the trace is written to by trace_end
+    */
+   void trace(const std::string &filename){
+
+      std::lock_guard<std::mutex> guard(lock);
+
+      trace_file = filename;
+      events.clear();
+
+      origin = std::chrono::steady_clock::now();
+      tracing = true;
+
+#ifdef _PROFILE
+      btas::tracer() = kernel;
+#endif
+
+   }
+
+   /**
+    * stop recording and write the trace in the Chrome trace event format (JSON), which can be opened in chrome://tracing or Perfetto
+    */
+   void trace_end(){
+
+      std::lock_guard<std::mutex> guard(lock);
+
+      if(!tracing)
+         return;
+
+#ifdef _PROFILE
+      btas::tracer() = 0;
+#endif
+
+      tracing = false;
+
+      std::ofstream out(trace_file.c_str());
+
+      //not BTAS_THROW: this has to be checked in optimized builds as well
+      if(!out)
+         throw std::runtime_error("profile::trace_end: could not open " + trace_file);
+
+      out << std::fixed << std::setprecision(3);
+
+      out << "{\"traceEvents\":[" << endl;
+
+      for(int e = 0;e < events.size();++e){
+
+         const Event &event = events[e];
+
+         out << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.cat << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.tid
+
+            << ",\"ts\":" << event.ts << ",\"dur\":" << event.dur;
+
+         if(event.args != "")
+            out << ",\"args\":{\"shapes\":\"" << event.args << "\",\"bytes\":" << std::setprecision(0) << event.bytes << std::setprecision(3) << "}";
+
+         out << "}" << ((e + 1 < events.size()) ? "," : "") << endl;
+
+      }
+
+      out << "],\"displayTimeUnit\":\"ms\"}" << endl;
+
+      events.clear();
+
+   }
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -31,7 +31,8 @@ namespace propagate {
    template<size_t M>
       void update(const PROP_DIR &dir,int row,int col,PEPS<double> &peps,DArray<M> &L,DArray<M> &R,int n_iter){
 
-         enum {i,j,k,l,m,n,o};
+         PROFILE_SCOPE(profile::label(dir,row));
+         FOOTPRINT_TAG("update");
 
          //containers for left and right intermediary objects
          DArray<M+2> LI;
@@ -60,15 +61,15 @@ namespace propagate {
          if(dir == VERTICAL){// (row,col) --> (row+1,col)
 
             //left and right operators:
-            Contract(1.0,peps(row,col),shape(i,j,k,l,m),global::trot.gLO_n(),shape(k,o,n),0.0,lop,shape(i,j,n,o,l,m));
-            Contract(1.0,peps(row+1,col),shape(i,j,k,l,m),global::trot.gRO_n(),shape(k,o,n),0.0,rop,shape(i,j,n,o,l,m));
+            apply(peps(row,col),global::trot.gLO_n(),global::trot.gLO_n_nz(),lop);
+            apply(peps(row+1,col),global::trot.gRO_n(),global::trot.gRO_n_nz(),rop);
 
          }
          else if(dir == HORIZONTAL){// (row,col) --> (row,col+1)
 
             //left and right operators:
-            Contract(1.0,peps(row,col),shape(i,j,k,l,m),global::trot.gLO_n(),shape(k,o,n),0.0,lop,shape(i,j,n,o,l,m));
-            Contract(1.0,peps(row,col+1),shape(i,j,k,l,m),global::trot.gRO_n(),shape(k,o,n),0.0,rop,shape(i,j,n,o,l,m));
+            apply(peps(row,col),global::trot.gLO_n(),global::trot.gLO_n_nz(),lop);
+            apply(peps(row,col+1),global::trot.gRO_n(),global::trot.gRO_n_nz(),rop);
 
          }
          else if(dir == DIAGONAL_LURD){//(row+1,col) --> (row,col+1)
@@ -76,8 +77,8 @@ namespace propagate {
             //middle peps is left bottom 
             mop = peps(row,col);
 
-            Contract(1.0,peps(row+1,col),shape(i,j,k,l,m),global::trot.gLO_nn(),shape(k,o,n),0.0,lop,shape(i,j,n,o,l,m));
-            Contract(1.0,peps(row,col+1),shape(i,j,k,l,m),global::trot.gRO_nn(),shape(k,o,n),0.0,rop,shape(i,j,n,o,l,m));
+            apply(peps(row+1,col),global::trot.gLO_nn(),global::trot.gLO_nn_nz(),lop);
+            apply(peps(row,col+1),global::trot.gRO_nn(),global::trot.gRO_nn_nz(),rop);
 
          }
          else{//(row,col) --> (row+1,col+1)
@@ -85,8 +86,8 @@ namespace propagate {
             //middle peps is bottom right
             mop = peps(row,col+1);
 
-            Contract(1.0,peps(row,col),shape(i,j,k,l,m),global::trot.gLO_nn(),shape(k,o,n),0.0,lop,shape(i,j,n,o,l,m));
-            Contract(1.0,peps(row+1,col+1),shape(i,j,k,l,m),global::trot.gRO_nn(),shape(k,o,n),0.0,rop,shape(i,j,n,o,l,m));
+            apply(peps(row,col),global::trot.gLO_nn(),global::trot.gLO_nn_nz(),lop);
+            apply(peps(row+1,col+1),global::trot.gRO_nn(),global::trot.gRO_nn_nz(),rop);
 
          }
 
@@ -134,6 +135,12 @@ namespace propagate {
          // --- (f) --- set top and bottom back on equal footing
          equilibrate(dir,row,col,peps);
 
+         //the rows of the updated sites have changed
+         peps.touch(row);
+
+         if(dir != HORIZONTAL)
+            peps.touch(row + 1);
+
       }
 
    /**
@@ -156,6 +163,8 @@ namespace propagate {
 
             const DArray<M+2> &b_L,const DArray<M+2> &b_R, int n_sweeps){
 
+         PROFILE_SCOPE("sweep");
+
          //indices of sites between which to jump back and forth
          int l_row(row),l_col(col),r_row(row),r_col(col);
 
@@ -217,6 +226,18 @@ namespace propagate {
             //solve the system
             solve(N_eff,rhs);
 
+            //relative change of the 'right' peps in the last sweep: how far the alternating least squares is from convergence
+            if(iter == n_sweeps - 1 && telemetry::active()){
+
+               DArray<5> change;
+               Permute(rhs,shape(0,1,4,2,3),change);
+
+               Axpy(-1.0,peps(r_row,r_col),change);
+
+               telemetry::maximum("als_change",Nrm2(change) / Nrm2(rhs));
+
+            }
+
             //update 'right' peps
             Permute(rhs,shape(0,1,4,2,3),peps(r_row,r_col));
 
@@ -225,26 +246,61 @@ namespace propagate {
 
          }
 
+         telemetry::add("updates",1);
+         telemetry::add("als_sweeps",n_sweeps);
+
       }
 
    /**
     * propagate the peps one imaginary time step
     * @param peps the PEPS to be propagated
     * @param n_sweeps the number of sweeps performed for the solution of the linear problem
+    * @param energy if true, the energy of the state before the step is evaluated from the environment of the step: the bottom layers
+    * left by the previous step are carried through the canonicalization of the top rows (see Environment::gauge) and closed with the
+    * new top layers, so it costs the energy contraction but no extra environment. When the bottom layers are not up to date, e.g. in the
+    * first step, they are recalculated.
+    * @return the energy per the norm of the state before the step if energy is true, 0 otherwise
     */
-   void step(PEPS<double> &peps,int n_sweeps){
+   double step(PEPS<double> &peps,int n_sweeps,bool energy){
+
+      PROFILE_SCOPE("propagate");
 
       enum {i,j,k,l,m,n,o};
 
+      double val = 0.0;
+
+      //the bottom layers of the previous step describe the state before this one, and are kept if they are still up to date
+      bool keep = energy && env.gmethod() == 'M';
+
+      for(int row = 0;row < Ly - 2;++row)
+         if(env.stale('b',row,peps))
+            keep = false;
+
       //'canonicalize' top environment
-      for(int row = Ly - 1;row > 1;--row)
-         shift_row('t',row,peps);
+      for(int row = Ly - 1;row > 1;--row){
+
+         vector< DArray<2> > gauge;
+
+         shift_row('t',row,peps,keep ? &gauge : 0);
+
+         if(keep)
+            env.gauge(row - 1,gauge,peps);
+
+      }
 
       peps.rescale_tensors(scal_num);
 
       //calculate top environment
       env.calc('T',peps);
 
+      if(energy){
+
+         env.update('B',peps);
+
+         val = peps.energy() / peps.dot(peps,true);
+
+      }
+
       //containers for the renormalized operators
       vector< DArray<5> > R(Lx);
 
@@ -303,11 +359,15 @@ namespace propagate {
       peps.rescale_tensors(0,scal_num);
 
       //and make the new bottom environment
-      env.gb(0).fill('b',peps);
+      env.fill('b',peps);
 
       //all middle rows:
       for(int row = 1;row < Lx - 2;++row){
 
+         //the top layer of the next row can be read in from the store while this row is updated
+         if(row + 1 < Ly - 2)
+            env.prefetch('t',row + 1);
+
          //containers for the renormalized operators
          vector< DArray<6> > RO(Lx);
 
@@ -423,6 +483,8 @@ namespace propagate {
 
       //one last vertical update
       update(VERTICAL,Ly-2,Lx-1,peps,L,R[Lx-1],n_sweeps); 
+
+      return val;
  
    }
 
@@ -433,6 +495,8 @@ namespace propagate {
     */
    void solve(DArray<8> &N_eff,DArray<5> &rhs){
 
+      PROFILE_SCOPE("solve");
+
       int matdim = N_eff.shape(0) * N_eff.shape(1) * N_eff.shape(2) * N_eff.shape(3);
 
       //symmetrize
@@ -450,10 +514,49 @@ namespace propagate {
 
       lapack::sytrs(CblasRowMajor,'U',matdim,d, N_eff.data(),matdim,ipiv, rhs.data(),d);
 
+      //Bunch-Kaufman factorization and the solve for d right hand sides
+      PROFILE_FLOPS(matdim * (matdim / 3.0 + 2.0 * d) * matdim);
+
       delete [] ipiv;
 
    }
 
+   /**
+    * act with a split trotter operator on a peps site, out(i,j,s_,k,l,m) = sum_s site(i,j,s,l,m) op(s,k,s_), using only the nonzero
+    * elements of op: every element adds a scaled copy of a physical slice of the site. The result is the same as that of Contract
+    * @param site the peps site
+    * @param op split trotter operator (d,dim,d), for its shape
+    * @param nz the nonzero elements of op
+    * @param out the site acted on, output
+    */
+   void apply(const DArray<5> &site,const DArray<3> &op,const vector<Trotter::Element> &nz,DArray<6> &out){
+
+      int dim = op.shape(1);
+
+      out.resize(site.shape(0),site.shape(1),d,dim,site.shape(3),site.shape(4));
+      out = 0.0;
+
+      int outer = site.shape(0) * site.shape(1);
+      int inner = site.shape(3) * site.shape(4);
+
+      for(int e = 0;e < nz.size();++e){
+
+         const Trotter::Element &el = nz[e];
+
+         for(int ij = 0;ij < outer;++ij){
+
+            const double *from = site.data() + (ij * d + el.s) * inner;
+            double *to = out.data() + ((ij * d + el.s_) * dim + el.k) * inner;
+
+            for(int lm = 0;lm < inner;++lm)
+               to[lm] += el.value * from[lm];
+
+         }
+
+      }
+
+   }
+
    /**
     * first guess/ initialization of the peps pair by performing an SVD
     * @param dir vertical, horizontal,diagonal lurd or diagonal ldru update
@@ -465,6 +568,8 @@ namespace propagate {
     */ 
    void initialize(const PROP_DIR &dir,int row,int col,const DArray<6> &lop,const DArray<6> &rop,PEPS<double> &peps){
 
+      PROFILE_SCOPE("initialize");
+
       if(dir == VERTICAL){//row --> row+1
 
          DArray<8> tmp8;
@@ -606,6 +711,8 @@ namespace propagate {
     */ 
    void equilibrate(const PROP_DIR &dir,int row,int col,PEPS<double> &peps){
 
+      PROFILE_SCOPE("equilibrate");
+
       if(dir == VERTICAL){
 
          DArray<8> tmp8;
@@ -754,6 +861,9 @@ namespace propagate {
 
             const DArray<5> &L,const DArray<5> &R,DArray<7> &LI7,DArray<7> &RI7){
 
+         PROFILE_SCOPE("construct_intermediate");
+         FOOTPRINT_TAG("construct_intermediate");
+
          if(dir == VERTICAL){
 
             //only LI7
@@ -1007,6 +1117,9 @@ namespace propagate {
 
             const DArray<6> &LO,const DArray<6> &RO,DArray<8> &LI8,DArray<8> &RI8){
 
+         PROFILE_SCOPE("construct_intermediate");
+         FOOTPRINT_TAG("construct_intermediate");
+
          if(dir == VERTICAL){
 
             //right
@@ -1127,6 +1240,8 @@ namespace propagate {
 
             const DArray<5> &mop, const DArray<5> &L,const DArray<5> &R,DArray<7> &b_L,DArray<7> &b_R){
 
+         PROFILE_SCOPE("construct_intermediate_rhs");
+
          if(dir == DIAGONAL_LURD){
 
             if(row == 0){//only b_L here
@@ -1219,6 +1334,8 @@ namespace propagate {
 
             const DArray<5> &mop, const DArray<6> &LO,const DArray<6> &RO,DArray<8> &b_L,DArray<8> &b_R){
 
+         PROFILE_SCOPE("construct_intermediate_rhs");
+
          if(dir == DIAGONAL_LURD){
 
             //only LI8 differs from b_L
@@ -1272,6 +1389,9 @@ namespace propagate {
 
             const DArray<5> &L, const DArray<5> &R, const DArray<7> &LI7,const DArray<7> &RI7, bool left){
 
+         PROFILE_SCOPE("N_eff");
+         FOOTPRINT_TAG("N_eff");
+
          if(dir == VERTICAL){
 
             if(row == 0){
@@ -1773,6 +1893,9 @@ namespace propagate {
 
             const DArray<6> &LO, const DArray<6> &RO, const DArray<8> &LI8,const DArray<8> &RI8, bool left){
 
+         PROFILE_SCOPE("N_eff");
+         FOOTPRINT_TAG("N_eff");
+
          if(dir == VERTICAL){
 
             if(left){//bottom site
@@ -2007,6 +2130,8 @@ namespace propagate {
 
             const DArray<7> &b_L,const DArray<7> &b_R,bool left){
 
+         PROFILE_SCOPE("rhs");
+
          if(dir == VERTICAL){
 
             if(row == 0){
@@ -2531,6 +2656,8 @@ namespace propagate {
 
             const DArray<8> &b_L,const DArray<8> &b_R,bool left){
 
+         PROFILE_SCOPE("rhs");
+
          if(dir ==  VERTICAL){
 
             if(left){
@@ -2791,6 +2918,8 @@ namespace propagate {
 
             DArray<7> &LI7,DArray<7> &RI7,std::vector< DArray<2> > &R_l,std::vector< DArray<2> > &R_r){
 
+         PROFILE_SCOPE("canonicalize");
+
          // ----------------------------//
          // --- (A) ---- LEFT SITE ---- //
          // ----------------------------//
@@ -3798,6 +3927,8 @@ namespace propagate {
 
             DArray<8> &LI8,DArray<8> &RI8,std::vector< DArray<2> > &R_l,std::vector< DArray<2> > &R_r){
 
+         PROFILE_SCOPE("canonicalize");
+
          // ----------------------------//
          // --- (A) ---- LEFT SITE ---- //
          // ----------------------------//
@@ -4490,6 +4621,8 @@ namespace propagate {
 
             std::vector< DArray<2> > &R_l, std::vector< DArray<2> > &R_r){
 
+         PROFILE_SCOPE("restore");
+
          //set left and right indices
          int lrow = row;
          int rrow = row;
@@ -4917,6 +5050,8 @@ namespace propagate {
 
             std::vector< DArray<2> > &R_l, std::vector< DArray<2> > &R_r){
 
+         PROFILE_SCOPE("restore");
+
          //set left and right indices
          int lrow = row;
          int rrow = row;
@@ -5249,6 +5384,8 @@ namespace propagate {
     */
    void shift_col(char option,int row,int col,PEPS<double> &peps){
 
+      PROFILE_SCOPE("shift_col");
+
       if(option == 'r'){//shift to the right
 
          //QR
@@ -5276,6 +5413,8 @@ namespace propagate {
 
       }
 
+      peps.touch(row);
+
    }
 
    /**
@@ -5283,8 +5422,11 @@ namespace propagate {
     * @param option top or bottom shift?
     * @param row what row are you on
     * @param peps object containing the tensors
+    * @param R if not 0, the R factors of every column are stored in it (new bond,old bond)
     */
-   void shift_row(char option,int row,PEPS<double> &peps){
+   void shift_row(char option,int row,PEPS<double> &peps,vector< DArray<2> > *R){
+
+      PROFILE_SCOPE("shift_row");
 
       if(option == 'b'){
 
@@ -5299,6 +5441,9 @@ namespace propagate {
 
             Permute(tmp5,shape(0,4,1,2,3),peps(row,col));
 
+            if(R)
+               R->push_back(tmp2);
+
             //add to down side of upper tensor
             tmp5.clear();
             Contract(1.0,tmp2,shape(1),peps(row+1,col),shape(3),0.0,tmp5);
@@ -5307,6 +5452,9 @@ namespace propagate {
 
          }
 
+         peps.touch(row);
+         peps.touch(row + 1);
+
       }
       else{//top: shift the QR downwards
 
@@ -5321,6 +5469,9 @@ namespace propagate {
 
             Permute(tmp5,shape(0,1,2,4,3),peps(row,col));
 
+            if(R)
+               R->push_back(tmp2);
+
             //add to up side of lower tensor
             tmp5.clear();
             Contract(1.0,tmp2,shape(1),peps(row-1,col),shape(1),0.0,tmp5);
@@ -5330,6 +5481,9 @@ namespace propagate {
 
          }
 
+         peps.touch(row);
+         peps.touch(row - 1);
+
       }
 
    }
@@ -0,0 +1,334 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <chrono>
+#include <cmath>
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+#include "include.h"
+
+namespace schedule {
+
+   /**
+    * one imaginary time step of the PEPS, followed by its energy
+    * @param peps the PEPS<double> to evolve
+    * @param index index of the step in the energy history, under which it is reported to the telemetry
+    * @param measure 'F' energy from a full contraction after the step, 'S' estimate made during the step from its own environment
+    * @param normalized if true the tensors are rescaled and the state is normalized after the step, if false only its norm is tracked
+    * @return the energy per the state norm after the step
+    */
+   double step(PEPS<double> &peps,int index,char measure,bool normalized){
+
+      double val;
+
+      {
+         PROFILE_SCOPE("step");
+         FOOTPRINT_TAG("step");
+
+         double before = propagate::step(peps,10,measure == 'S');
+
+         //the step keeps the tensors bounded and normalizes every strip, a full normalization is only needed as an occasional anchor
+         if(normalized){
+
+            peps.rescale_tensors(global::scal_num);
+            peps.normalize();
+
+         }
+
+         if(measure == 'S')
+            val = before;
+         else{
+
+            PROFILE_SCOPE("energy");
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            global::env.update('A',peps);
+
+            if(normalized)
+               val = peps.energy();
+            else
+               val = peps.energy() / peps.dot(peps,true);
+
+            telemetry::add("energy_time",std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+         }
+
+      }
+
+      //where the time of the step went, only with -D_PROFILE
+      PROFILE_REPORT(cout);
+
+      telemetry::emit(index,val,peps.glog_norm());
+
+      return val;
+
+   }
+
+   /**
+    * read a ramp from a string of comma separated stages "D:D_aux:tol:max_steps", tol (default 1e-5) and max_steps (default 500) may be left out
+    * @param str the string, e.g. "2:16:1e-4:200,3:27,4:40"
+    * @return the stages
+    */
+   vector<Stage> parse(const std::string &str){
+
+      vector<Stage> stages;
+
+      std::istringstream in(str);
+      std::string item;
+
+      while(std::getline(in,item,',')){
+
+         Stage stage;
+
+         stage.tol = 1.0e-5;
+         stage.max_steps = 500;
+
+         std::istringstream fields(item);
+         std::string field;
+
+         vector<std::string> f;
+
+         while(std::getline(fields,field,':'))
+            f.push_back(field);
+
+         //not BTAS_THROW: this has to be checked in optimized builds as well
+         if(f.size() < 2 || f.size() > 4)
+            throw std::runtime_error("schedule::parse: stage '" + item + "' is not of the form D:D_aux[:tol[:max_steps]]");
+
+         stage.D = atoi(f[0].c_str());
+         stage.D_aux = atoi(f[1].c_str());
+
+         if(f.size() > 2)
+            stage.tol = atof(f[2].c_str());
+
+         if(f.size() > 3)
+            stage.max_steps = atoi(f[3].c_str());
+
+         if(stage.D < 1 || stage.D_aux < 1 || stage.max_steps < 1)
+            throw std::runtime_error("schedule::parse: stage '" + item + "' has an invalid dimension or nr of steps");
+
+         stages.push_back(stage);
+
+      }
+
+      return stages;
+
+   }
+
+   /**
+    * grow the bond dimension of a converged PEPS without losing it. The tensors are rescaled to a largest element scal_num and padded by
+    * PEPS::grow_bond_dimension with noise relative to that, after which a first step is done at the new dimensions. A small noise keeps
+    * the state, but leaves new bond directions that are nearly empty, and the update, which inverts the environment on them, can blow up
+    * when the environment is not accurate there. So the growth is only accepted when the energy after the first step is not worse than that
+    * of the converged state by more than tol, nor better by more than ten times the gain of a step before the growth, which is as sure a sign
+    * of a broken down environment as a nan. Else the padding is redone with a tenfold larger noise. If no noise passes, the attempt with the
+    * lowest energy that did not break down is kept.
+    * @param peps the PEPS<double>, on exit with bond dimension D, after one step
+    * @param index index of the first step at the new bond dimension in the energy history: every attempt is reported under it
+    * @param D the new bond dimension
+    * @param noise smallest relative size of the random elements added to the tensors
+    * @param tol allowed increase of the energy
+    * @param gain decrease of the energy in the last step before the growth
+    * @return the energy after the first step at the new bond dimension
+    */
+   double grow(PEPS<double> &peps,int index,int D,double noise,double tol,double gain){
+
+      //reference: the converged state, with the auxiliary dimension of the new stage
+      global::sD(peps.gD());
+
+      global::env.update('A',peps);
+
+      double ref = peps.energy() / peps.dot(peps,true);
+
+      PEPS<double> old(peps);
+
+      PEPS<double> best;
+      double val_best = 0.0;
+
+      bool found = false;
+
+      for(int attempt = 0;attempt < 3;++attempt){
+
+         if(attempt > 0)
+            peps = old;
+
+         peps.rescale_tensors(global::scal_num);
+         peps.grow_bond_dimension(D,noise * global::scal_num);
+
+         //new environment for the new dimensions, the method and settings are kept
+         global::sD(D);
+
+         //the padded tensors are brought back to the usual scale
+         peps.normalize();
+
+         peps.rescale_tensors(global::scal_num);
+         peps.normalize();
+
+         double val = step(peps,index,'F',false);
+
+         cout << "grow\t" << D << "\t" << noise << "\t" << ref << "\t" << val << endl;
+
+         //nan fails every comparison
+         bool sane = (val >= ref - 10.0 * std::max(fabs(gain),tol));
+
+         if(sane && val <= ref + tol)
+            return val;
+
+         if(sane && (!found || val < val_best)){
+
+            best = peps;
+            val_best = val;
+
+            found = true;
+
+         }
+
+         noise *= 10.0;
+
+      }
+
+      //not BTAS_THROW: this has to be checked in optimized builds as well
+      if(!found)
+         throw std::runtime_error("schedule::grow: the update breaks down at the new bond dimension for every noise");
+
+      std::cerr << "schedule::grow: the energy got worse growing D to " << D << " with every noise, the lowest is kept" << endl;
+
+      peps = best;
+
+      return val_best;
+
+   }
+
+   /**
+    * evolve the PEPS through a ramp of bond dimensions: every stage is run until the energy has converged, after which the tensors are padded
+    * with noise to the next D by grow, which also does the first step of the stage, and the environment is reallocated for the new D and D_aux.
+    * Most of the steps are done at the cheap bond dimensions, and every stage starts from the converged state of the previous one.
+    * @param peps the PEPS<double> to evolve, its current D is the starting point
+    * @param stages the stages, with a non decreasing D
+    * @param noise size of the random elements added to the tensors when D grows, relative to the largest elements of the tensors
+    * @param measure 'F' or 'S', see step
+    * @param anchor the state is normalized every anchor steps, counted in the energy history
+    * @param energy input: energy history so far, output: the energies of all the steps of the ramp are appended
+    * @return the report of every stage
+    */
+   vector<Report> ramp(PEPS<double> &peps,const vector<Stage> &stages,double noise,char measure,int anchor,vector<double> &energy){
+
+      std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+      vector<Report> reports;
+
+      for(int s = 0;s < stages.size();++s){
+
+         const Stage &stage = stages[s];
+
+         if(stage.D < peps.gD())
+            throw std::runtime_error("schedule::ramp: the bond dimension can only grow");
+
+         std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+         Report report;
+
+         report.D = stage.D;
+         report.D_aux = stage.D_aux;
+
+         report.steps = 0;
+         report.converged = false;
+
+         if(stage.D != global::D || stage.D_aux != global::D_aux || stage.D != peps.gD()){
+
+            global::D_aux = stage.D_aux;
+
+            if(stage.D > peps.gD()){
+
+               int i = energy.size();
+
+               double tol = (s > 0) ? stages[s - 1].tol : stage.tol;
+               double gain = (i > 1) ? energy[i - 2] - energy[i - 1] : tol;
+
+               energy.push_back(grow(peps,i,stage.D,noise,tol,gain));
+               ++report.steps;
+
+               cout << i << "\t" << energy.back() << endl;
+
+            }
+            else{
+
+               //new environment for the new dimensions, the method and settings are kept
+               global::sD(stage.D);
+
+               peps.normalize();
+
+               peps.rescale_tensors(global::scal_num);
+               peps.normalize();
+
+            }
+
+         }
+
+         while(report.steps < stage.max_steps && !report.converged){
+
+            int i = energy.size();
+
+            double val = step(peps,i,measure,(i + 1) % anchor == 0);
+
+            //the first step after a change of dimension is not compared with the previous stage
+            if(report.steps > 0 && fabs(val - energy.back()) < stage.tol)
+               report.converged = true;
+
+            energy.push_back(val);
+            ++report.steps;
+
+            cout << i << "\t" << val << endl;
+
+         }
+
+         std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+         report.energy = energy.back();
+
+         report.time = std::chrono::duration<double>(end - start).count();
+         report.total = std::chrono::duration<double>(end - begin).count();
+
+         reports.push_back(report);
+
+         cout << "stage\t" << report.D << "\t" << report.D_aux << "\t" << report.steps << "\t" << report.energy << "\t" << report.time << endl;
+
+      }
+
+      return reports;
+
+   }
+
+   /**
+    * print the reports of a ramp as a table: the time to reach the energy of a stage is the total time up to its end
+    * @param out the stream to print to
+    * @param reports the reports returned by ramp
+    */
+   void print(ostream &out,const vector<Report> &reports){
+
+      std::streamsize precision = out.precision();
+
+      out << "#D\tD_aux\tsteps\tconverged\tenergy\t\t\ttime\t\ttime-to-energy" << endl;
+
+      for(int s = 0;s < reports.size();++s){
+
+         out << reports[s].D << "\t" << reports[s].D_aux << "\t" << reports[s].steps << "\t" << (reports[s].converged ? "yes" : "no") << "\t\t"
+
+            << std::setprecision(15) << reports[s].energy << "\t" << std::setprecision(6) << reports[s].time << "\t\t" << reports[s].total << endl;
+
+      }
+
+      out.precision(precision);
+
+   }
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
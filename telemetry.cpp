@@ -0,0 +1,282 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <stdexcept>
+#include <cstdlib>
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using std::cout;
+using std::endl;
+
+#include "include.h"
+
+namespace telemetry {
+
+   //!true while a stream is open, checked before anything is measured for it
+   static std::atomic<bool> on(false);
+
+   //!counters of the current step: summed and maximal values
+   static std::map<std::string,double> sums;
+   static std::map<std::string,double> maxima;
+
+   //!protects the counters
+   static std::mutex counter_lock;
+
+   //!wall and cpu time at the end of the previous step
+   static std::chrono::steady_clock::time_point wall;
+   static double cpu = 0.0;
+
+   //!background thread which writes the lines, the file and the lines which wait to be written
+   static std::thread writer;
+   static std::ofstream out;
+   static std::deque<std::string> queue;
+
+   //!protects queue and stop
+   static std::mutex lock;
+
+   //!signals new lines to the writer
+   static std::condition_variable line_cv;
+
+   //!true when the writer has to stop
+   static bool stop = false;
+
+   /**
+    * @return user and system time used by the process up to now, in seconds
+    */
+   static double cpu_time(){
+
+      struct rusage usage;
+      getrusage(RUSAGE_SELF,&usage);
+
+      return usage.ru_utime.tv_sec + 1.0e-6 * usage.ru_utime.tv_usec + usage.ru_stime.tv_sec + 1.0e-6 * usage.ru_stime.tv_usec;
+
+   }
+
+   /**
+    * the writer: writes and flushes the queued lines until it is stopped and the queue is empty
+    */
+   static void run(){
+
+      std::unique_lock<std::mutex> guard(lock);
+
+      while(true){
+
+         line_cv.wait(guard,[]{ return stop || !queue.empty(); });
+
+         if(queue.empty())
+            return;
+
+         std::deque<std::string> lines;
+         lines.swap(queue);
+
+         //the I/O is done without holding the lock, so the step never waits for the file system
+         guard.unlock();
+
+         for(std::deque<std::string>::const_iterator it = lines.begin();it != lines.end();++it)
+            out << *it << '\n';
+
+         out.flush();
+
+         guard.lock();
+
+      }
+
+   }
+
+   /**
+    * start a stream: every step done by schedule::step is appended to the file as a line with a JSON object
+    * @param filename the file, lines are appended to it if it exists
+    */
+   void open(const std::string &filename){
+
+      close();
+
+      out.open(filename.c_str(),std::ios::app);
+
+      //not BTAS_THROW: this has to be checked in optimized builds as well
+      if(!out)
+         throw std::runtime_error("telemetry::open: could not open " + filename);
+
+      {
+         std::lock_guard<std::mutex> guard(counter_lock);
+
+         sums.clear();
+         maxima.clear();
+
+      }
+
+      wall = std::chrono::steady_clock::now();
+      cpu = cpu_time();
+
+      stop = false;
+      writer = std::thread(run);
+
+      static bool registered = false;
+
+      if(!registered){
+
+         atexit(telemetry::close);
+         registered = true;
+
+      }
+
+      on = true;
+
+   }
+
+   /**
+    * stop the stream: the lines which are still queued are written and the file is closed
+    */
+   void close(){
+
+      on = false;
+
+      {
+         std::lock_guard<std::mutex> guard(lock);
+         stop = true;
+      }
+
+      line_cv.notify_all();
+
+      if(writer.joinable())
+         writer.join();
+
+      if(out.is_open())
+         out.close();
+
+   }
+
+   /**
+    * @return true if a stream is open: counters which cost something to measure should only be measured if it is
+    */
+   bool active(){
+
+      return on;
+
+   }
+
+   /**
+    * add to a counter of the current step, e.g. a time or a nr of iterations
+    * @param key name of the counter
+    * @param value what is added
+    */
+   void add(const char *key,double value){
+
+      if(!on)
+         return;
+
+      std::lock_guard<std::mutex> guard(counter_lock);
+
+      sums[key] += value;
+
+   }
+
+   /**
+    * keep the largest value of a counter in the current step, e.g. an error
+    * @param key name of the counter
+    * @param value the value
+    */
+   void maximum(const char *key,double value){
+
+      if(!on)
+         return;
+
+      std::lock_guard<std::mutex> guard(counter_lock);
+
+      std::map<std::string,double>::iterator it = maxima.find(key);
+
+      if(it == maxima.end())
+         maxima[key] = value;
+      else if(value > it->second)
+         it->second = value;
+
+   }
+
+   /**
+    * end a step: a line is queued with the step, the dimensions, the energy and log-norm, the wall time of the step and the fraction of
+    * the cores of the threads the process kept busy, the memory, and the counters of the step, which start over. With -D_FOOTPRINT the memory
+    * is the heap (current and high-water mark), else the largest resident set size of the process so far (getrusage), in bytes.
+    * @param step index of the step in the energy history: it is given by the caller, so it continues after a restart from a checkpoint,
+    * and the attempts of schedule::grow are reported under the same step
+    * @param energy energy after the step
+    * @param log_norm log of the norm of the PEPS
+    */
+   void emit(int step,double energy,double log_norm){
+
+      if(!on)
+         return;
+
+      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      double used = cpu_time();
+
+      double time = std::chrono::duration<double>(now - wall).count();
+
+#ifdef _OPENMP
+      int threads = omp_get_max_threads();
+#else
+      int threads = 1;
+#endif
+
+      std::ostringstream line;
+      line.precision(15);
+
+      line << "{\"step\":" << step << ",\"D\":" << global::D << ",\"D_aux\":" << global::D_aux << ",\"energy\":" << energy << ",\"log_norm\":" << log_norm
+
+         << ",\"time\":" << time << ",\"threads\":" << threads << ",\"utilization\":" << ((time > 0.0) ? (used - cpu) / (time * threads) : 0.0);
+
+#ifdef _FOOTPRINT
+      line << ",\"heap\":" << (long long) footprint::current() << ",\"heap_peak\":" << (long long) footprint::peak();
+#else
+      struct rusage usage;
+      getrusage(RUSAGE_SELF,&usage);
+
+      //in kB on Linux
+      line << ",\"max_rss\":" << 1024LL * usage.ru_maxrss;
+#endif
+
+      {
+         std::lock_guard<std::mutex> guard(counter_lock);
+
+         for(std::map<std::string,double>::const_iterator it = sums.begin();it != sums.end();++it)
+            line << ",\"" << it->first << "\":" << it->second;
+
+         for(std::map<std::string,double>::const_iterator it = maxima.begin();it != maxima.end();++it)
+            line << ",\"" << it->first << "\":" << it->second;
+
+         sums.clear();
+         maxima.clear();
+
+      }
+
+      line << "}";
+
+      {
+         std::lock_guard<std::mutex> guard(lock);
+         queue.push_back(line.str());
+      }
+
+      line_cv.notify_one();
+
+      wall = now;
+      cpu = used;
+
+   }
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/